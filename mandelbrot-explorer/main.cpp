@@ -1,86 +1,365 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
-#include <fstream>
+#include <cstdlib>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include "program_cache.h"
+#include "render/cpu_renderer.h"
+#include "render/view_state.h"
+#include "resolution_scaler.h"
+#include "shader_sources.h"
+#include "triple_buffer.h"
 
 int windowWidth = 1200;
 int windowHeight = 800;
 
 int max_iterations = 300;
 
-GLuint shaderProgram;
-GLuint vertexShader;
-double zoom;
-double pan_x;
-double pan_y;
+ViewState view;
 bool leftMousePressed = false;
 double lastX, lastY;
-
-bool use_double_precision = false;
-bool auto_switch_double_precision = true;
+// Cursor movement not yet turned into a pan. Drags pan by whole pixels so that frames can reuse the one before, the
+// fraction left over is carried to the next event and the view still follows the cursor exactly.
+double drag_residue_x = 0.0;
+double drag_residue_y = 0.0;
+
+// Fragment shader variants, from the fastest to the deepest. The CPU variants are rendered by cpu_renderer and shown
+// as a texture.
+enum class Precision { Single, FloatFloat, Double, CpuDoubleDouble, Perturbation, CpuPerturbation };
+
+Precision precision = Precision::Single;
+bool auto_precision = true;
+
+// The variants that iterate every pixel directly and the mantissa bits they carry. Float-float gets a little less
+// than two floats out of its error terms. Double-double runs on the CPU, where perturbation on the GPU renders the
+// same depths faster even with its reference orbit (see mandelbrot-render --bench multi-double), so the automatic
+// choice passes over it and only X selects it.
+struct PrecisionRung {
+    Precision precision;
+    int mantissa_bits;
+    bool automatic;
+};
+
+const PrecisionRung precision_ladder[] = {
+    {Precision::Single, 24, true},
+    {Precision::FloatFloat, 46, true},
+    {Precision::Double, 53, true},
+    {Precision::CpuDoubleDouble, 106, false},
+};
+
+// Bits kept between the pixel spacing and the rounding of coordinates near the center, so that neighbouring pixels
+// stay apart
+const double precision_margin_bits = 2.0;
+
+// The float offsets of fragmentShader_perturbation.glsl underflow beyond cpu_perturbation_zoom, deeper frames are
+// rendered on the CPU with double offsets
+const double cpu_perturbation_zoom = 1e30;
+
+// Linked programs by fragment shader file name, all built at startup so switching precision only swaps the handle
+std::map<std::string, GLuint> programs;
+// Program binaries of earlier runs, relative to the working directory
+const char* const program_cache_directory = "shader_cache";
+// Set by --shaders to read the shader files from there instead of the copies built into the executable
+std::string shader_directory;
+// Frame rate the dynamic resolution aims for while the view changes, set by --target-fps, 0 turns it off
+double target_fps = 60.0;
+// How long the view has to stay still before a frame drawn at a reduced resolution is drawn again at full resolution
+const std::chrono::milliseconds full_resolution_delay(150);
+
+// The View uniform block of the shaders in std140 layout. All of them declare the same members up to orbit_length,
+// fragmentShader_doubles.glsl adds its doubles after those.
+struct alignas(16) ViewUniforms {
+    float pan[2];
+    float pan_hi[2];
+    float pan_lo[2];
+    float reference_offset[2];
+    float zoom;
+    float inverse_zoom;
+    float aspect_ratio;
+    int32_t max_iterations;
+    int32_t orbit_length;
+    // std140 aligns a dvec2 to 16 bytes
+    int32_t padding[3];
+    double pan_double[2];
+    double zoom_double;
+};
+static_assert(offsetof(ViewUniforms, pan_double) == 64 && sizeof(ViewUniforms) == 96, "std140 layout of View");
 
 float aspectRatio = static_cast<float>(windowWidth) / static_cast<float>(windowHeight);
 
-void reset_zoom_and_pan() {
-    zoom = 0.5;
-    pan_x = 0.0;
-    pan_y = 0.0;
+// Everything a frame depends on. The callbacks run on the main thread and change the globals above, then publish a
+// copy of them. The render thread owns the GL context and draws the newest copy, so a slow frame never holds up input.
+struct FrameState {
+    ViewState view;
+    Precision precision = Precision::Single;
+    int max_iterations = 0;
+    int width = 0;
+    int height = 0;
+    float aspect_ratio = 1.0f;
+    std::chrono::steady_clock::time_point published;
+};
+
+TripleBuffer<FrameState> frame_states;
+// Advanced with every published view, so a CPU frame still working on an older one stops within a few milliseconds
+RenderGeneration render_generation;
+
+// Set when the window needs drawing, after a new view was published, the window was uncovered or for work that
+// finishes over several frames. The render thread sleeps on render_wake while it is not set.
+std::atomic<bool> redraw_requested{true};
+std::atomic<bool> render_thread_running{true};
+std::mutex render_wake_mutex;
+std::condition_variable render_wake;
+
+// Frames drawn since the title was last updated and the GL calls of the last one, shown in the title bar
+std::atomic<int> frames_drawn{0};
+std::atomic<int> last_frame_gl_calls{0};
+// Milliseconds from publishing the view of the last CPU frame to its first pass and to its full resolution pass on
+// screen, -1 before the first one
+std::atomic<int> cpu_first_pass_ms{-1};
+std::atomic<int> cpu_full_frame_ms{-1};
+// Resolution of the last frame in percent of the window's, shown in the title bar
+std::atomic<int> resolution_scale_percent{100};
+// Pixels the last frame computed, fewer than the window has when it reused the one before
+std::atomic<long long> last_frame_computed_pixels{0};
+
+// Only touched by the render thread after startup
+GLuint viewUniformBuffer;
+std::unique_ptr<CpuRenderer> cpu_renderer;
+// Reference orbit for Precision::Perturbation
+GLuint orbitBuffer;
+GLuint orbitTexture;
+// Frame for the variants that render on the CPU
+GLuint frameTexture;
+bool cpu_frame_dirty = true;
+int frame_gl_calls = 0;
+int viewportWidth = 0;
+int viewportHeight = 0;
+// Shader frames below full resolution are drawn into this and stretched to the window. Its color buffer is kept at
+// the window's size and a frame only uses the lower left part of it.
+GLuint scaledFramebuffer;
+GLuint scaledColorbuffer;
+int scaledFramebufferWidth = 0;
+int scaledFramebufferHeight = 0;
+std::unique_ptr<ResolutionScaler> resolution_scaler;
+// Timer queries of the frames whose GPU time is still outstanding, oldest first, read once the GPU is done with them
+// so that the render thread never waits for a result
+const int frame_time_query_count = 4;
+GLuint frameTimeQueries[frame_time_query_count];
+float frame_time_scales[frame_time_query_count];
+int oldest_frame_time = 0;
+int pending_frame_times = 0;
+// Full resolution shader frames are drawn into one of these and copied to the window. A pan of whole pixels shifts
+// the last of them into the other and only draws the strips that came into view.
+GLuint historyFramebuffers[2];
+GLuint historyColorbuffers[2];
+int historyWidth = 0;
+int historyHeight = 0;
+int history_index = 0;
+// The last shader frame drawn, and whether historyFramebuffers[history_index] holds it at full resolution
+FrameState last_shader_frame;
+bool shader_frame_drawn = false;
+bool history_valid = false;
+
+const char* precision_name(Precision value) {
+    switch (value) {
+        case Precision::FloatFloat:
+            return "float-float";
+        case Precision::Double:
+            return "double";
+        case Precision::CpuDoubleDouble:
+            return "CPU double-double";
+        case Precision::Perturbation:
+            return "perturbation";
+        case Precision::CpuPerturbation:
+            return "CPU perturbation";
+        default:
+            return "single";
+    }
 }
 
-std::string readShaderFile(const std::string& filePath) {
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open file: " << filePath << std::endl;
-        return "";
+const char* fragment_shader_name(Precision value) {
+    switch (value) {
+        case Precision::FloatFloat:
+            return "fragmentShader_floatfloat.glsl";
+        case Precision::Double:
+            return "fragmentShader_doubles.glsl";
+        case Precision::Perturbation:
+            return "fragmentShader_perturbation.glsl";
+        case Precision::CpuDoubleDouble:
+        case Precision::CpuPerturbation:
+            return "fragmentShader_frame.glsl";
+        default:
+            return "fragmentShader.glsl";
     }
+}
 
-    std::ostringstream content;
-    content << file.rdbuf();
-    return content.str();
+bool renders_on_cpu(Precision value) {
+    return value == Precision::CpuDoubleDouble || value == Precision::CpuPerturbation;
 }
 
-GLuint compileShader(GLenum shaderType, const std::string& source) {
-    GLuint shader = glCreateShader(shaderType);
-    const char* sourceCStr = source.c_str();
-    glShaderSource(shader, 1, &sourceCStr, nullptr);
-    glCompileShader(shader);
+// Mantissa bits a coordinate needs to keep neighbouring pixels apart: the magnitude of the center over the pixel
+// spacing, plus the margin. The window width sets the spacing, so larger windows need precision at lower zooms.
+double needed_mantissa_bits() {
+    FloatExp spacing = FloatExp(2.0) / (view.zoom() * FloatExp(windowWidth));
+    double magnitude = std::max(std::abs(view.pan_x()), std::abs(view.pan_y()));
+    double magnitude_log2 = magnitude > 0.0 ? std::log2(magnitude) : spacing.log2();
+    return std::max(magnitude_log2 - spacing.log2(), 0.0) + precision_margin_bits;
+}
 
-    // Check compilation status
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetShaderInfoLog(shader, sizeof(infoLog), nullptr, infoLog);
-        std::cerr << "Shader compilation failed: " << infoLog << std::endl;
-        glDeleteShader(shader);
-        return 0;
+struct PrecisionChoice {
+    Precision precision;
+    std::string reason;
+};
+
+// The cheapest variant that still resolves the pixels of the view, and why. Without perturbation the deepest plain
+// shader is the last resort.
+PrecisionChoice choose_precision(bool allow_perturbation) {
+    char reason[160];
+    if (allow_perturbation && view.zoom() > cpu_perturbation_zoom) {
+        snprintf(reason, sizeof(reason), "zoom %s is past %g, where the shader's float offsets underflow",
+                 view.zoom().to_string(2).c_str(), cpu_perturbation_zoom);
+        return {Precision::CpuPerturbation, reason};
     }
 
-    return shader;
+    double needed = needed_mantissa_bits();
+    const PrecisionRung* deepest = nullptr;
+    for (const PrecisionRung& rung : precision_ladder) {
+        if (!rung.automatic) continue;
+        if (needed <= rung.mantissa_bits) {
+            snprintf(reason, sizeof(reason), "pixels need %.1f bits, %s has %d", needed,
+                     precision_name(rung.precision), rung.mantissa_bits);
+            return {rung.precision, reason};
+        }
+        deepest = &rung;
+    }
+
+    snprintf(reason, sizeof(reason), "pixels need %.1f bits, more than the %d of %s", needed, deepest->mantissa_bits,
+             precision_name(deepest->precision));
+    return {allow_perturbation ? Precision::Perturbation : deepest->precision, reason};
 }
 
-void update_all_shader_parameters() {
-    glUseProgram(shaderProgram);
-    if (use_double_precision) {
-        GLint zoomDoubleLocation = glGetUniformLocation(shaderProgram, "zoom_double");
-        GLint panDoubleLocation = glGetUniformLocation(shaderProgram, "pan_double");
-        glUniform1d(zoomDoubleLocation, zoom);
-        glUniform2d(panDoubleLocation, pan_x, pan_y);
-    } else {
-        GLint zoomLocation = glGetUniformLocation(shaderProgram, "zoom");
-        GLint panLocation = glGetUniformLocation(shaderProgram, "pan");
-        glUniform1f(zoomLocation, zoom);
-        glUniform2f(panLocation, pan_x, pan_y);
+// Asks the render thread for another frame, from any thread
+void request_redraw() {
+    redraw_requested = true;
+    // Taking the mutex once orders this against a render thread that is just about to wait, so the wakeup is not
+    // lost. The render thread only holds it while it checks redraw_requested, never during a frame.
+    { std::lock_guard<std::mutex> lock(render_wake_mutex); }
+    render_wake.notify_one();
+}
+
+// Hands the current view to the render thread. Called after every change, it only copies the view and never waits
+// for the frame in flight.
+void publish_frame_state() {
+    FrameState& state = frame_states.write_slot();
+    state.view = view;
+    state.precision = precision;
+    state.max_iterations = max_iterations;
+    state.width = windowWidth;
+    state.height = windowHeight;
+    state.aspect_ratio = aspectRatio;
+    state.published = std::chrono::steady_clock::now();
+    frame_states.publish();
+    render_generation.advance();
+    request_redraw();
+}
+
+// The view as the CPU renderer sees it in perturbation mode
+RenderParams perturbation_params(FrameState& frame) {
+    RenderParams params;
+    params.width = frame.width;
+    params.height = frame.height;
+    params.zoom = frame.view.zoom();
+    params.aspectRatio = frame.aspect_ratio;
+    params.max_iterations = frame.max_iterations;
+    params.use_perturbation = true;
+    params.center_x = frame.view.center_x();
+    params.center_y = frame.view.center_y();
+    return params;
+}
+
+// The view as the shader of frame.precision sees it, to tell how far it panned
+RenderParams shader_params(FrameState& frame) {
+    if (frame.precision == Precision::Perturbation) {
+        return perturbation_params(frame);
     }
+    RenderParams params;
+    params.width = frame.width;
+    params.height = frame.height;
+    params.zoom = frame.view.zoom();
+    params.pan_x = frame.view.pan_x();
+    params.pan_y = frame.view.pan_y();
+    params.aspectRatio = frame.aspect_ratio;
+    params.max_iterations = frame.max_iterations;
+    params.use_double_precision = frame.precision == Precision::Double;
+    return params;
+}
 
-    GLint maxIterLocation = glGetUniformLocation(shaderProgram, "max_iterations");
-    GLint aspectRatioLocation = glGetUniformLocation(shaderProgram, "aspectRatio");
-    glUniform1i(maxIterLocation, max_iterations);
-    glUniform1f(aspectRatioLocation, aspectRatio);
+// Brings the reference orbit up to date with the view and sets the uniforms fragmentShader_perturbation.glsl reads
+// it with
+void update_reference_orbit(FrameState& frame, ViewUniforms& uniforms) {
+    RenderParams params = perturbation_params(frame);
+    const ReferenceOrbit& orbit = cpu_renderer->reference_orbit();
+    if (cpu_renderer->update_reference_orbit(params)) {
+        std::vector<float> points;
+        points.reserve(2 * orbit.points.size());
+        for (const OrbitPoint& point : orbit.points) {
+            points.push_back(static_cast<float>(point.x));
+            points.push_back(static_cast<float>(point.y));
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, orbitBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, points.size() * sizeof(float), points.data(), GL_STATIC_DRAW);
+        frame_gl_calls += 2;
+    }
+
+    double offset_x = ((params.center_x - orbit.c_x).to_float_exp() * params.zoom).to_double();
+    double offset_y = ((params.center_y - orbit.c_y).to_float_exp() * params.zoom).to_double();
+    uniforms.orbit_length = static_cast<int32_t>(orbit.points.size());
+    uniforms.reference_offset[0] = static_cast<float>(offset_x);
+    uniforms.reference_offset[1] = static_cast<float>(offset_y);
+}
+
+// Writes the whole view into viewUniformBuffer in one upload. Every shader finds its values there, so switching
+// programs needs no upload of its own.
+void upload_view_uniforms(FrameState& frame) {
+    const ViewState& frame_view = frame.view;
+    ViewUniforms uniforms = {};
+    double inverse_zoom = (1.0 / frame_view.zoom()).to_double();
+    uniforms.pan[0] = static_cast<float>(frame_view.pan_x());
+    uniforms.pan[1] = static_cast<float>(frame_view.pan_y());
+    // The pan split into a float and the float rounding error of it
+    uniforms.pan_hi[0] = uniforms.pan[0];
+    uniforms.pan_hi[1] = uniforms.pan[1];
+    uniforms.pan_lo[0] = static_cast<float>(frame_view.pan_x() - uniforms.pan_hi[0]);
+    uniforms.pan_lo[1] = static_cast<float>(frame_view.pan_y() - uniforms.pan_hi[1]);
+    uniforms.zoom = static_cast<float>(frame_view.zoom().to_double());
+    uniforms.inverse_zoom = static_cast<float>(inverse_zoom);
+    uniforms.aspect_ratio = frame.aspect_ratio;
+    uniforms.max_iterations = frame.max_iterations;
+    uniforms.pan_double[0] = frame_view.pan_x();
+    uniforms.pan_double[1] = frame_view.pan_y();
+    uniforms.zoom_double = frame_view.zoom().to_double();
+    if (frame.precision == Precision::Perturbation) {
+        update_reference_orbit(frame, uniforms);
+    }
+
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(uniforms), &uniforms);
+    frame_gl_calls++;
 }
 
 void change_max_iterations(bool increase) {
@@ -92,83 +371,285 @@ void change_max_iterations(bool increase) {
         max_iterations = std::max(max_iterations, 10);
     }
     printf("max iterations= %d\n", max_iterations);
-    update_all_shader_parameters();
+    publish_frame_state();
 }
 
-void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
-    // Update viewport size
-    glViewport(0, 0, width, height);
+void update_automatic_precision();
 
-    // Update window size and aspect ratio
+void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
+    // Update window size and aspect ratio, the render thread sets the viewport from them
     windowWidth = width;
     windowHeight = height;
     aspectRatio = static_cast<float>(windowWidth) / static_cast<float>(windowHeight);
 
-    // Update the aspectRatio uniform in the shader
-    update_all_shader_parameters();
+    // The aspect ratio changes the uniforms, the pixel spacing changes with the width
+    update_automatic_precision();
+    publish_frame_state();
 }
 
-void toggle_double_precision() {
-    use_double_precision = !use_double_precision;
-    std::string fragmentShaderSource;
-    if (use_double_precision) {
-        fragmentShaderSource = readShaderFile("shaders/fragmentShader_doubles.glsl");
+void set_precision(Precision new_precision) {
+    precision = new_precision;
+    publish_frame_state();
+}
+
+// Steps through the variants that iterate every pixel directly: single, float-float, double, CPU double-double
+void cycle_precision() {
+    switch (precision) {
+        case Precision::Single:
+            set_precision(Precision::FloatFloat);
+            break;
+        case Precision::FloatFloat:
+            set_precision(Precision::Double);
+            break;
+        case Precision::Double:
+            set_precision(Precision::CpuDoubleDouble);
+            break;
+        default:
+            set_precision(Precision::Single);
+            break;
+    }
+}
+
+// Switches between perturbation, on the GPU as long as its float offsets hold, and the plain shaders
+void toggle_perturbation() {
+    if (precision == Precision::Perturbation || precision == Precision::CpuPerturbation) {
+        set_precision(choose_precision(false).precision);
     } else {
-        fragmentShaderSource = readShaderFile("shaders/fragmentShader.glsl");
+        set_precision(view.zoom() > cpu_perturbation_zoom ? Precision::CpuPerturbation : Precision::Perturbation);
     }
+}
 
-    GLuint newFragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+void set_viewport(int width, int height) {
+    if (width == viewportWidth && height == viewportHeight) return;
+    viewportWidth = width;
+    viewportHeight = height;
+    glViewport(0, 0, width, height);
+    frame_gl_calls++;
+}
 
-    // Link the new shader program
-    GLuint newShaderProgram = glCreateProgram();
-    glAttachShader(newShaderProgram, vertexShader);
-    glAttachShader(newShaderProgram, newFragmentShader);
-    glLinkProgram(newShaderProgram);
+// Draws the quad with the bound program into the window at full resolution and shows it
+void present_frame(GLFWwindow* window, const FrameState& frame) {
+    set_viewport(frame.width, frame.height);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    frame_gl_calls += 2;
+
+    glfwSwapBuffers(window);
+    last_frame_gl_calls = frame_gl_calls;
+    frame_gl_calls = 0;
+    frames_drawn++;
+}
 
-    // Cleanup the old shader program
-    glDeleteProgram(shaderProgram);
+// Hands the GPU times of the frames the GPU has finished to resolution_scaler
+void collect_frame_times() {
+    while (pending_frame_times > 0) {
+        GLuint query = frameTimeQueries[oldest_frame_time];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        frame_gl_calls++;
+        if (!available) return;
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+        frame_gl_calls++;
+        resolution_scaler->add_frame_time(nanoseconds * 1e-9, frame_time_scales[oldest_frame_time]);
+        oldest_frame_time = (oldest_frame_time + 1) % frame_time_query_count;
+        pending_frame_times--;
+    }
+}
 
-    // Use the new shader program
-    glUseProgram(newShaderProgram);
+// Sizes the history color buffers to the frame, which leaves nothing in them to reuse
+void resize_history(const FrameState& frame) {
+    if (frame.width == historyWidth && frame.height == historyHeight) return;
+    historyWidth = frame.width;
+    historyHeight = frame.height;
+    for (GLuint colorbuffer : historyColorbuffers) {
+        glBindRenderbuffer(GL_RENDERBUFFER, colorbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, frame.width, frame.height);
+        frame_gl_calls += 2;
+    }
+    history_valid = false;
+}
 
-    // Update the current shader program
-    shaderProgram = newShaderProgram;
+// Whole pixels (dx, dy) the view of frame is panned from that of the last shader frame, false if it changed in any
+// other way
+bool panned_by_whole_pixels(FrameState& frame, int& dx, int& dy) {
+    return shader_frame_drawn && frame.precision == last_shader_frame.precision &&
+           pixel_shift(shader_params(last_shader_frame), shader_params(frame), dx, dy);
+}
+
+// Finishes a shader frame drawn into framebuffer at width x height: stretches it to the window and shows it
+void show_shader_frame(GLFWwindow* window, const FrameState& frame, GLuint framebuffer, int width, int height) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, frame.width, frame.height, GL_COLOR_BUFFER_BIT,
+                      width == frame.width && height == frame.height ? GL_NEAREST : GL_LINEAR);
+    frame_gl_calls += 3;
+    last_shader_frame = frame;
+    shader_frame_drawn = true;
+
+    glfwSwapBuffers(window);
+    last_frame_gl_calls = frame_gl_calls;
+    frame_gl_calls = 0;
+    frames_drawn++;
+}
+
+// Draws a shader frame at scale times the window's resolution and shows it. Full resolution frames go to the history
+// for the pans after them, smaller ones are drawn into scaledFramebuffer and stretched to the window. With measure set
+// the GPU time of the frame goes to resolution_scaler.
+void present_scaled_frame(GLFWwindow* window, const FrameState& frame, float scale, bool measure) {
+    if (measure) {
+        collect_frame_times();
+    }
+    // With every query still in flight the frame goes untimed rather than waiting for the GPU
+    bool timed = measure && pending_frame_times < frame_time_query_count;
+    int slot = (oldest_frame_time + pending_frame_times) % frame_time_query_count;
+
+    int width = std::max(1, static_cast<int>(std::lround(frame.width * scale)));
+    int height = std::max(1, static_cast<int>(std::lround(frame.height * scale)));
+    GLuint framebuffer;
+    if (scale < 1.0f) {
+        if (frame.width != scaledFramebufferWidth || frame.height != scaledFramebufferHeight) {
+            scaledFramebufferWidth = frame.width;
+            scaledFramebufferHeight = frame.height;
+            glBindRenderbuffer(GL_RENDERBUFFER, scaledColorbuffer);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, frame.width, frame.height);
+            frame_gl_calls += 2;
+        }
+        framebuffer = scaledFramebuffer;
+        history_valid = false;
+    } else {
+        resize_history(frame);
+        framebuffer = historyFramebuffers[history_index];
+        history_valid = true;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    frame_gl_calls++;
+    set_viewport(width, height);
 
-    // Cleanup the old fragment shader
-    glDeleteShader(newFragmentShader);
+    if (timed) {
+        glBeginQuery(GL_TIME_ELAPSED, frameTimeQueries[slot]);
+    }
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    frame_gl_calls++;
+    if (timed) {
+        glEndQuery(GL_TIME_ELAPSED);
+        frame_time_scales[slot] = static_cast<float>(width) / frame.width;
+        pending_frame_times++;
+        frame_gl_calls += 2;
+    }
+    last_frame_computed_pixels = static_cast<long long>(width) * height;
 
-    update_all_shader_parameters();
+    show_shader_frame(window, frame, framebuffer, width, height);
 }
 
-void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
-    // Change zoom
-    float viewport_width_before = 2.0f / zoom;
+// Draws a full resolution shader frame whose view panned by whole pixels (dx, dy) since the last one, which is in the
+// history: the pixels both share are copied over shifted and the shader only draws the strips that came into view.
+// A view that did not move at all only copies the last frame to the window.
+void present_reprojected_frame(GLFWwindow* window, const FrameState& frame, int dx, int dy) {
+    if (dx == 0 && dy == 0) {
+        last_frame_computed_pixels = 0;
+        show_shader_frame(window, frame, historyFramebuffers[history_index], frame.width, frame.height);
+        return;
+    }
 
-    float factor = std::pow(1.2f, static_cast<float>(yoffset));
+    int width = frame.width;
+    int height = frame.height;
+    // Rows of framebuffers run upward, so the pixel at (x, y) is the one at (x + dx, y - dy) of the last frame
+    int x0 = std::max(0, -dx);
+    int x1 = std::min(width, width - dx);
+    int y0 = std::max(0, dy);
+    int y1 = std::min(height, height + dy);
+    int next = 1 - history_index;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, historyFramebuffers[history_index]);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, historyFramebuffers[next]);
+    glBlitFramebuffer(x0 + dx, y0 - dy, x1 + dx, y1 - dy, x0, y0, x1, y1, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    frame_gl_calls += 3;
+
+    // Whole rows below and above the shifted pixels, then the parts of their rows left and right of them. The scissor
+    // test runs before the fragment shader, so pixels outside a strip cost nothing.
+    const int strips[4][4] = {{0, 0, width, y0}, {0, y1, width, height}, {0, y0, x0, y1}, {x1, y0, width, y1}};
+    long long computed = 0;
+    set_viewport(width, height);
+    glEnable(GL_SCISSOR_TEST);
+    for (const auto& strip : strips) {
+        int strip_width = strip[2] - strip[0];
+        int strip_height = strip[3] - strip[1];
+        if (strip_width <= 0 || strip_height <= 0) continue;
+        glScissor(strip[0], strip[1], strip_width, strip_height);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        frame_gl_calls += 2;
+        computed += static_cast<long long>(strip_width) * strip_height;
+    }
+    glDisable(GL_SCISSOR_TEST);
+    frame_gl_calls += 2;
+    history_index = next;
+    last_frame_computed_pixels = computed;
+
+    show_shader_frame(window, frame, historyFramebuffers[history_index], width, height);
+}
 
-    zoom *= factor;
-    if (auto_switch_double_precision) {
-        bool udp = zoom > 10'000;
-        if (udp != use_double_precision) {
-            printf("Double precision = %s\n", udp ? "true" : "false");
-            toggle_double_precision();
+// Renders the view on the CPU, with perturbation or in double-double, in passes at 1/8, 1/4, 1/2 and full
+// resolution. Every pass is uploaded to frameTexture, the coarse ones are shown right away and the last is left for
+// the caller to draw. Returns false when a newer view cancelled it, the work done so far is kept in case that view
+// turns out to be the same frame.
+bool render_cpu_frame(GLFWwindow* window, FrameState& frame, const CancellationToken& cancel) {
+    RenderParams params = perturbation_params(frame);
+    if (frame.precision == Precision::CpuDoubleDouble) {
+        params.use_perturbation = false;
+        params.extended_precision = ExtendedPrecision::DoubleDouble;
+    }
+
+    bool first_pass = true;
+    auto present_pass = [&](const std::vector<uint8_t>& rgba, int spacing) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, frame.width, frame.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     rgba.data());
+        frame_gl_calls++;
+        auto latency = std::chrono::steady_clock::now() - frame.published;
+        int latency_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(latency).count());
+        if (first_pass) {
+            cpu_first_pass_ms = latency_ms;
+            first_pass = false;
+        }
+        if (spacing == 1) {
+            cpu_full_frame_ms = latency_ms;
+        } else {
+            present_frame(window, frame);
         }
+    };
+    if (!cpu_renderer->render_progressive(params, present_pass, cancel)) {
+        return false;
     }
+    last_frame_computed_pixels = cpu_renderer->computed_pixels();
+    cpu_frame_dirty = false;
+    return true;
+}
 
-    float viewport_width_after = 2.0f / zoom;
-    float view_port_delta = viewport_width_before - viewport_width_after;
+// Moves along the precision ladder when the view has left the range of the current variant. Zooming, panning and
+// resizing the window all change what the pixels need.
+void update_automatic_precision() {
+    if (!auto_precision) return;
+    PrecisionChoice wanted = choose_precision(true);
+    if (wanted.precision != precision) {
+        printf("Precision = %s: %s\n", precision_name(wanted.precision), wanted.reason.c_str());
+        set_precision(wanted.precision);
+    }
+}
 
+void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
     // Get the mouse position in screen coordinates
     double mouseX, mouseY;
     glfwGetCursorPos(window, &mouseX, &mouseY);
 
-    float ndcX = (2.0f * mouseX) / windowWidth - 1.0f;
-    float ndcY = 1.0f - (2.0f * mouseY) / windowHeight;
+    double ndcX = (2.0 * mouseX) / windowWidth - 1.0;
+    double ndcY = 1.0 - (2.0 * mouseY) / windowHeight;
 
-    pan_x += ndcX * view_port_delta / 2.0f;
-    pan_y += ndcY * view_port_delta / (2.0f * aspectRatio);
+    // Zoom around the point under the cursor
+    double factor = std::pow(1.2, yoffset);
+    view.zoom_at(factor, ndcX, ndcY / aspectRatio);
 
-    update_all_shader_parameters();
+    update_automatic_precision();
+    publish_frame_state();
 }
 
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
@@ -176,6 +657,8 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
         if (action == GLFW_PRESS) {
             leftMousePressed = true;
             glfwGetCursorPos(window, &lastX, &lastY);
+            drag_residue_x = 0.0;
+            drag_residue_y = 0.0;
         } else if (action == GLFW_RELEASE) {
             leftMousePressed = false;
         }
@@ -184,55 +667,70 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
 
 void cursorPosCallback(GLFWwindow* window, double xpos, double ypos) {
     if (leftMousePressed) {
-        // Calculate the difference in mouse position
-        double deltaX = xpos - lastX;
-        double deltaY = ypos - lastY;
-
-        // Update pan based on the difference
-        pan_x -= 2 * static_cast<double>(deltaX) / (windowWidth * zoom);
-        pan_y += 2 * static_cast<double>(deltaY) / (windowHeight * aspectRatio * zoom);
-
-        // Update the shader with the new zoom level and pan
-        update_all_shader_parameters();
+        // Calculate the difference in mouse position, in whole pixels. Taking those off the residue leaves it exact.
+        drag_residue_x += xpos - lastX;
+        drag_residue_y += ypos - lastY;
+        double deltaX = std::trunc(drag_residue_x);
+        double deltaY = std::trunc(drag_residue_y);
+        drag_residue_x -= deltaX;
+        drag_residue_y -= deltaY;
 
         // Update last mouse position
         lastX = xpos;
         lastY = ypos;
+        if (deltaX == 0.0 && deltaY == 0.0) return;
+
+        // Update pan based on the difference, in view coordinates
+        view.pan(-2 * deltaX / windowWidth, 2 * deltaY / (windowHeight * aspectRatio));
+
+        // The render thread draws the newest pan, however many mouse events come in during a frame
+        update_automatic_precision();
+        publish_frame_state();
     }
 }
 
+// Prints the view in full precision, along with the mandelbrot-render options that render it again
 void print_loc_info(GLFWwindow* window) {
     double mouseX, mouseY;
     glfwGetCursorPos(window, &mouseX, &mouseY);
 
-    float ndcX = (2.0f * mouseX) / windowWidth - 1.0f;
-    float ndcY = 1.0f - (2.0f * mouseY) / windowHeight;
+    double ndcX = (2.0 * mouseX) / windowWidth - 1.0;
+    double ndcY = 1.0 - (2.0 * mouseY) / windowHeight;
 
-    float screenTopLeftX = (-1.0f) / zoom + pan_x;
-    float screenTopLeftY = (1.0f) / zoom + pan_y;
-
-    printf("PAN (%.2f, %.2f), zoom: %.2f\n", pan_x, pan_y, zoom);
+    std::string center = view.describe_point(0.0, 0.0);
+    std::string zoom = view.zoom().to_string(6);
+    printf("Center: %s\n", center.c_str());
+    printf("Cursor: %s\n", view.describe_point(ndcX, ndcY / aspectRatio).c_str());
+    printf("Zoom: %s\n", zoom.c_str());
+    printf("mandelbrot-render --center %s --zoom %s --max-iterations %d\n", center.c_str(), zoom.c_str(),
+           max_iterations);
 }
 
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (action == GLFW_PRESS || action == GLFW_REPEAT) {
         switch (key) {
             case GLFW_KEY_R:
-                reset_zoom_and_pan();
-                // Update the shader with the new zoom level and pan
-                update_all_shader_parameters();
+                view.reset();
+                update_automatic_precision();
+                publish_frame_state();
                 printf("Resetting zoom and pan");
                 break;
             case GLFW_KEY_A:
-                auto_switch_double_precision = !auto_switch_double_precision;
-                printf("Auto double precision set to %s", auto_switch_double_precision ? "true" : "false");
+                auto_precision = !auto_precision;
+                printf("Automatic precision set to %s\n", auto_precision ? "true" : "false");
+                update_automatic_precision();
+                publish_frame_state();
                 break;
             case GLFW_KEY_SPACE:
                 print_loc_info(window);
                 break;
             case GLFW_KEY_X:
-                toggle_double_precision();
-                printf("Double precision set to %s", use_double_precision ? "true" : "false");
+                cycle_precision();
+                printf("Precision set to %s\n", precision_name(precision));
+                break;
+            case GLFW_KEY_P:
+                toggle_perturbation();
+                printf("Precision set to %s\n", precision_name(precision));
                 break;
             case GLFW_KEY_UP:
                 change_max_iterations(true);
@@ -244,27 +742,115 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
     }
 }
 
+void windowRefreshCallback(GLFWwindow* window) {
+    request_redraw();
+}
+
+// Shows the frames the render thread drew per second in the title bar, the main thread calls it after events
 void updateFPSCounter(GLFWwindow* window) {
     static double lastTime = glfwGetTime();
-    static int frameCount = 0;
-    static int fps = 0;
 
     double currentTime = glfwGetTime();
     double delta = currentTime - lastTime;
 
-    frameCount++;
     if (delta >= 1.0) {
-        fps = static_cast<int>(frameCount / delta);
-        frameCount = 0;
+        int fps = static_cast<int>(frames_drawn.exchange(0) / delta);
         lastTime = currentTime;
+
+        // Display FPS and the GL calls of the last frame on the window title bar
+        std::ostringstream title;
+        title << "Mandelbrot Explorer - FPS: " << fps << " - Resolution: " << resolution_scale_percent
+              << "% - GL calls/frame: " << last_frame_gl_calls << " - Pixels computed: " << last_frame_computed_pixels;
+        if (renders_on_cpu(precision) && cpu_full_frame_ms >= 0) {
+            title << " - CPU frame: first pass " << cpu_first_pass_ms << " ms, full " << cpu_full_frame_ms << " ms";
+        }
+        glfwSetWindowTitle(window, title.str().c_str());
     }
-    // Display FPS on the window title bar
-    std::ostringstream title;
-    title << "Mandelbrot Explorer - FPS: " << fps;
-    glfwSetWindowTitle(window, title.str().c_str());
 }
 
-int main() {
+// Runs on its own thread and owns the GL context. Draws whenever a new view was published or a redraw requested and
+// sleeps otherwise. Views published while a frame is in flight are skipped, the next frame takes the newest. While the
+// view changes, shader frames are drawn at the resolution that holds target_fps, once it stops the last of them is
+// drawn again at full resolution.
+void render_loop(GLFWwindow* window) {
+    glfwMakeContextCurrent(window);
+    GLuint boundProgram = 0;
+    float last_scale = 1.0f;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(render_wake_mutex);
+            auto woken = [] { return redraw_requested || !render_thread_running; };
+            if (last_scale < 1.0f) {
+                // Timing out means the view has been still long enough, the frame below is drawn at full resolution
+                render_wake.wait_for(lock, full_resolution_delay, woken);
+            } else {
+                render_wake.wait(lock, woken);
+            }
+        }
+        if (!render_thread_running) break;
+        redraw_requested = false;
+        frame_gl_calls = 0;
+
+        // Taken before the view, so any view published after this one cancels the frame
+        CancellationToken cancel(render_generation);
+        bool view_changed = frame_states.update();
+        FrameState& frame = frame_states.read_slot();
+        if (view_changed) {
+            upload_view_uniforms(frame);
+            cpu_frame_dirty = true;
+        }
+
+        GLuint program = programs.at(fragment_shader_name(frame.precision));
+        if (program != boundProgram) {
+            glUseProgram(program);
+            boundProgram = program;
+            frame_gl_calls++;
+        }
+        if (renders_on_cpu(frame.precision)) {
+            // A cancelled frame is not drawn, the newer view that cancelled it has already asked for the next one
+            if (!cpu_frame_dirty) {
+                last_frame_computed_pixels = 0;
+            } else if (!render_cpu_frame(window, frame, cancel)) {
+                continue;
+            }
+            last_scale = 1.0f;
+            present_frame(window, frame);
+        } else {
+            // A view that only panned by whole pixels reuses the last frame, or is drawn at full resolution for the
+            // pans after it to reuse. Only frames of a changing view are timed.
+            int dx;
+            int dy;
+            bool panned = panned_by_whole_pixels(frame, dx, dy);
+            if (panned && history_valid) {
+                last_scale = 1.0f;
+                present_reprojected_frame(window, frame, dx, dy);
+            } else {
+                last_scale = view_changed && !panned ? resolution_scaler->scale() : 1.0f;
+                present_scaled_frame(window, frame, last_scale, view_changed);
+            }
+        }
+        resolution_scale_percent = static_cast<int>(std::lround(last_scale * 100.0f));
+    }
+    glfwMakeContextCurrent(nullptr);
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--shaders" && i + 1 < argc) {
+            shader_directory = argv[++i];
+        } else if (arg == "--target-fps" && i + 1 < argc) {
+            target_fps = std::atof(argv[++i]);
+        } else {
+            std::cerr << "Usage: mandelbrot-explorer [--shaders DIR] [--target-fps N]\n"
+                      << "  --shaders DIR   read the shader files from DIR instead of the built-in copies\n"
+                      << "  --target-fps N  lower the resolution while the view changes to hold N frames per\n"
+                      << "                  second, 0 always renders at full resolution (default 60)" << std::endl;
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+
     // Initialize GLFW
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -292,29 +878,74 @@ int main() {
         return -1;
     }
 
-    // Load shaders from external files
-    std::string vertexShaderSource = readShaderFile("shaders/vertexShader.glsl");
-    std::string fragmentShaderSource = readShaderFile("shaders/fragmentShader.glsl");
-    std::string fragmentShaderSourceDouble = readShaderFile("shaders/fragmentShader_doubles.glsl");
-
-    if (vertexShaderSource.empty() || fragmentShaderSource.empty() || fragmentShaderSourceDouble.empty()) {
-        std::cerr << "Failed to load shader sources" << std::endl;
-        return -1;
+    // Build the program of every precision up front, from the binary cache when it has them
+    auto build_start = std::chrono::steady_clock::now();
+    std::string vertexShaderSource = shader_source("vertexShader.glsl", shader_directory);
+    ProgramCache program_cache(program_cache_directory);
+    const Precision all_precisions[] = {Precision::Single, Precision::FloatFloat, Precision::Double,
+                                        Precision::CpuDoubleDouble, Precision::Perturbation,
+                                        Precision::CpuPerturbation};
+    for (Precision value : all_precisions) {
+        std::string name = fragment_shader_name(value);
+        if (programs.count(name)) continue;
+        std::string fragmentShaderSource = shader_source(name, shader_directory);
+        GLuint program = 0;
+        if (!vertexShaderSource.empty() && !fragmentShaderSource.empty()) {
+            program = program_cache.build(vertexShaderSource, fragmentShaderSource);
+        }
+        if (!program) {
+            std::cerr << "Failed to build the shader program of " << name << std::endl;
+            return -1;
+        }
+        programs[name] = program;
     }
-
-    // Compile shaders
-    vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
-    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
-
-    // Link shader program
-
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    // Cleanup shaders
-    glDeleteShader(fragmentShader);
+    const ProgramCacheStats& cache_stats = program_cache.stats();
+    printf("Built %zu shader programs in %.1f ms, %d from cache, %d compiled\n", programs.size(),
+           std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count(),
+           cache_stats.loaded, cache_stats.compiled);
+
+    // Buffer texture that holds the reference orbit as one (x, y) texel per point
+    glGenBuffers(1, &orbitBuffer);
+    glGenTextures(1, &orbitTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, orbitTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, orbitBuffer);
+
+    // Texture that shows frames rendered on the CPU
+    glGenTextures(1, &frameTexture);
+    glBindTexture(GL_TEXTURE_2D, frameTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Uniform buffer with the View block of the shaders, bound once to the binding point they declare. It starts out
+    // zeroed, so the warm-up draws below do no iterations.
+    ViewUniforms initial_uniforms = {};
+    glGenBuffers(1, &viewUniformBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, viewUniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(initial_uniforms), &initial_uniforms, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, viewUniformBuffer);
+
+    cpu_renderer = std::make_unique<CpuRenderer>();
+    cpu_renderer->set_reprojection(true);
+
+    // Framebuffer for the shader frames drawn at a reduced resolution, its color buffer is sized at the first of them
+    glGenRenderbuffers(1, &scaledColorbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, scaledColorbuffer);
+    glGenFramebuffers(1, &scaledFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, scaledFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, scaledColorbuffer);
+    // Framebuffers the full resolution shader frames are drawn into, sized with the first of them
+    glGenRenderbuffers(2, historyColorbuffers);
+    glGenFramebuffers(2, historyFramebuffers);
+    for (int i = 0; i < 2; i++) {
+        glBindRenderbuffer(GL_RENDERBUFFER, historyColorbuffers[i]);
+        glBindFramebuffer(GL_FRAMEBUFFER, historyFramebuffers[i]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, historyColorbuffers[i]);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glGenQueries(frame_time_query_count, frameTimeQueries);
+    resolution_scaler = std::make_unique<ResolutionScaler>(target_fps);
 
     // Create Vertex Array Object (VAO) and Vertex Buffer Object (VBO)
     GLuint VAO, VBO;
@@ -333,6 +964,17 @@ int main() {
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
+    // Some drivers, Mesa's among them, only finish compiling a program at its first draw. One draw of each into the
+    // back buffer, which the first frame clears, keeps that out of the first switch to its precision.
+    auto warm_up_start = std::chrono::steady_clock::now();
+    for (const auto& entry : programs) {
+        glUseProgram(entry.second);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+    glFinish();
+    printf("Warmed up the shader programs in %.1f ms\n",
+           std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - warm_up_start).count());
+
     // frame resize callback
     glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
     // Set up key callback
@@ -343,27 +985,43 @@ int main() {
     glfwSetMouseButtonCallback(window, mouseButtonCallback);
     // Set up cursor position callback
     glfwSetCursorPosCallback(window, cursorPosCallback);
+    // Window uncovered or restored, its contents are gone
+    glfwSetWindowRefreshCallback(window, windowRefreshCallback);
 
-    reset_zoom_and_pan();
-    update_all_shader_parameters();
+    // State that stays the same for every frame: the VAO, the orbit and frame textures on their own targets of unit 0
+    // and the uniform buffer are all still bound from above
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    // The render thread takes over the context, this thread only handles events from here on
+    glfwMakeContextCurrent(nullptr);
+    publish_frame_state();
+    std::thread render_thread(render_loop, window);
 
-    // Render loop
     while (!glfwWindowShouldClose(window)) {
+        // Sleep until an event arrives, waking once a second to update the frame rate in the title
+        glfwWaitEventsTimeout(1.0);
         updateFPSCounter(window);
+    }
 
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        glUseProgram(shaderProgram);
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    render_thread_running = false;
+    request_redraw();
+    render_thread.join();
+    glfwMakeContextCurrent(window);
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    // Cleanup programs
+    for (const auto& entry : programs) {
+        glDeleteProgram(entry.second);
     }
-
-    // Cleanup shaders
-    glDeleteShader(vertexShader);
+    glDeleteTextures(1, &orbitTexture);
+    glDeleteBuffers(1, &orbitBuffer);
+    glDeleteTextures(1, &frameTexture);
+    glDeleteBuffers(1, &viewUniformBuffer);
+    glDeleteFramebuffers(1, &scaledFramebuffer);
+    glDeleteRenderbuffers(1, &scaledColorbuffer);
+    glDeleteFramebuffers(2, historyFramebuffers);
+    glDeleteRenderbuffers(2, historyColorbuffers);
+    glDeleteQueries(frame_time_query_count, frameTimeQueries);
+    cpu_renderer.reset();
 
     // Cleanup
     glDeleteVertexArrays(1, &VAO);
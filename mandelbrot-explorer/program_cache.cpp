@@ -0,0 +1,179 @@
+#include "program_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char program_file_magic[8] = {'M', 'B', 'P', 'R', 'O', 'G', '0', '1'};
+
+struct ProgramFileHeader {
+    char magic[8];
+    // The full key, file names only hold it in hex and another build could share one by accident
+    uint64_t key;
+    uint32_t binary_format;
+    uint32_t length;
+};
+
+// FNV-1a over text and a terminating separator, so that ("ab", "c") and ("a", "bc") hash apart
+uint64_t hash_text(uint64_t hash, const std::string& text) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    hash ^= 0xff;
+    hash *= 0x100000001b3ull;
+    return hash;
+}
+
+std::string gl_string(GLenum name) {
+    const GLubyte* value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+GLuint compile_shader(GLenum shaderType, const std::string& source) {
+    GLuint shader = glCreateShader(shaderType);
+    const char* sourceCStr = source.c_str();
+    glShaderSource(shader, 1, &sourceCStr, nullptr);
+    glCompileShader(shader);
+
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, sizeof(infoLog), nullptr, infoLog);
+        std::cerr << "Shader compilation failed: " << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+}  // namespace
+
+ProgramCache::ProgramCache(const std::string& directory) : directory(directory) {
+    driver = gl_string(GL_VENDOR) + "\n" + gl_string(GL_RENDERER) + "\n" + gl_string(GL_VERSION);
+    GLint formats = 0;
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    }
+    binaries_supported = formats > 0;
+    if (binaries_supported) {
+        std::error_code error;
+        fs::create_directories(directory, error);
+    }
+}
+
+GLuint ProgramCache::build(const std::string& vertex_source, const std::string& fragment_source) {
+    uint64_t key = hash_text(hash_text(hash_text(0xcbf29ce484222325ull, driver), vertex_source), fragment_source);
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    std::string path = (fs::path(directory) / name).string();
+
+    if (binaries_supported) {
+        GLuint program = load(path, key);
+        if (program) {
+            cache_stats.loaded++;
+            return program;
+        }
+    }
+
+    GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_source);
+    GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+    if (!vertex_shader || !fragment_shader) {
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    if (binaries_supported) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
+    // Only flagged for deletion while the program holds them
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(program, sizeof(infoLog), nullptr, infoLog);
+        std::cerr << "Shader program linking failed: " << infoLog << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    cache_stats.compiled++;
+
+    if (binaries_supported) {
+        store(path, key, program);
+    }
+    return program;
+}
+
+GLuint ProgramCache::load(const std::string& path, uint64_t key) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return 0;
+
+    ProgramFileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, program_file_magic, sizeof(header.magic)) != 0 || header.key != key) {
+        return 0;
+    }
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size())) return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binary_format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(program);
+        cache_stats.rejected++;
+        return 0;
+    }
+    return program;
+}
+
+void ProgramCache::store(const std::string& path, uint64_t key, GLuint program) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    std::vector<char> binary(length);
+    GLenum binary_format = 0;
+    glGetProgramBinary(program, length, &length, &binary_format, binary.data());
+
+    ProgramFileHeader header = {};
+    std::memcpy(header.magic, program_file_magic, sizeof(header.magic));
+    header.key = key;
+    header.binary_format = binary_format;
+    header.length = static_cast<uint32_t>(length);
+
+    // Written next to its final name and renamed, so a run that stops halfway never leaves half a binary behind
+    std::string temporary = path + "." + std::to_string(std::random_device()()) + ".tmp";
+    bool written;
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), length);
+        written = static_cast<bool>(file);
+    }
+    std::error_code error;
+    if (written) {
+        fs::rename(temporary, path, error);
+    }
+    if (!written || error) {
+        cache_stats.failed_writes++;
+        fs::remove(temporary, error);
+    }
+}
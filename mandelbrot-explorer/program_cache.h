@@ -0,0 +1,38 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+
+struct ProgramCacheStats {
+    // Programs restored from a binary a previous run saved
+    int loaded = 0;
+    // Programs compiled and linked from source
+    int compiled = 0;
+    // Binaries the driver rejected, after a driver update for example, which were compiled again
+    int rejected = 0;
+    int failed_writes = 0;
+};
+
+// Builds shader programs from a vertex and a fragment shader source, and keeps the linked binaries in a directory so
+// later runs skip compiling and linking. A binary is keyed by the driver's vendor, renderer and version strings and
+// both sources, so an edited shader or another driver builds from source again. Without program binary support
+// every program is compiled, as if the cache were empty.
+class ProgramCache {
+   public:
+    explicit ProgramCache(const std::string& directory);
+
+    // Linked program, or 0 after printing the log when compiling or linking fails
+    GLuint build(const std::string& vertex_source, const std::string& fragment_source);
+
+    const ProgramCacheStats& stats() const { return cache_stats; }
+
+   private:
+    GLuint load(const std::string& path, uint64_t key);
+    void store(const std::string& path, uint64_t key, GLuint program);
+
+    std::string directory;
+    std::string driver;
+    bool binaries_supported = false;
+    ProgramCacheStats cache_stats;
+};
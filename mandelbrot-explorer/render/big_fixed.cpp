@@ -0,0 +1,362 @@
+#include "big_fixed.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+BigFixed::BigFixed(const FloatExp& value, int fraction_limbs)
+    : limbs(fraction_limbs + 1, 0), negative(value.mantissa() < 0.0) {
+    // The mantissa is in [1, 2), so anything from 2^31 on would lose its high bits to the single integer limb
+    assert(value.is_zero() || value.exponent() < 31);
+    if (value.is_zero()) {
+        negative = false;
+        return;
+    }
+
+    // The 53-bit integer significand, and the bit of the lowest limb its lowest bit lands on
+    uint64_t significand = static_cast<uint64_t>(std::ldexp(std::fabs(value.mantissa()), 52));
+    int64_t position = value.exponent() - 52 + 32 * static_cast<int64_t>(fraction_limbs);
+    if (position < 0) {
+        significand = position <= -64 ? 0 : significand >> -position;
+        position = 0;
+    }
+
+    // The significand spans at most three limbs from the one its lowest bit lands on
+    size_t limb = static_cast<size_t>(position / 32);
+    int offset = static_cast<int>(position % 32);
+    for (size_t i = 0; i < 3 && limb + i < limbs.size(); i++) {
+        int from = 32 * static_cast<int>(i) - offset;
+        uint64_t part = from >= 0 ? (from >= 64 ? 0 : significand >> from) : significand << -from;
+        limbs[limb + i] = static_cast<uint32_t>(part);
+    }
+    if (is_zero()) {
+        negative = false;
+    }
+}
+
+bool BigFixed::parse(const std::string& text, int fraction_limbs, BigFixed& value) {
+    size_t pos = 0;
+    bool negative = false;
+    if (pos < text.size() && (text[pos] == '-' || text[pos] == '+')) {
+        negative = text[pos] == '-';
+        pos++;
+    }
+
+    size_t integer_begin = pos;
+    uint64_t integer = 0;
+    while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+        integer = integer * 10 + (text[pos] - '0');
+        if (integer >= (1u << 31)) {
+            return false;
+        }
+        pos++;
+    }
+    size_t integer_digits = pos - integer_begin;
+
+    size_t fraction_begin = pos;
+    if (pos < text.size() && text[pos] == '.') {
+        fraction_begin = ++pos;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+            pos++;
+        }
+    }
+    size_t fraction_digits = pos - fraction_begin;
+    if (pos != text.size() || integer_digits + fraction_digits == 0) {
+        return false;
+    }
+
+    // Horner's scheme from the last digit: x = (x + digit) / 10, using the integer limb to hold the digit
+    BigFixed result;
+    result.limbs.assign(fraction_limbs + 1, 0);
+    for (size_t i = pos; i-- > fraction_begin;) {
+        result.limbs.back() += static_cast<uint32_t>(text[i] - '0');
+        uint64_t remainder = 0;
+        for (size_t j = result.limbs.size(); j-- > 0;) {
+            uint64_t current = (remainder << 32) | result.limbs[j];
+            result.limbs[j] = static_cast<uint32_t>(current / 10);
+            remainder = current % 10;
+        }
+    }
+    result.limbs.back() = static_cast<uint32_t>(integer);
+    result.negative = negative && !result.is_zero();
+    value = result;
+    return true;
+}
+
+BigFixed BigFixed::from_raw_limbs(const uint32_t* limbs, int count, bool negative) {
+    BigFixed value;
+    value.limbs.assign(limbs, limbs + count);
+    value.negative = negative && !value.is_zero();
+    return value;
+}
+
+void BigFixed::set_fraction_limbs(int count) {
+    int current = fraction_limbs();
+    if (count > current) {
+        limbs.insert(limbs.begin(), count - current, 0);
+    } else if (count < current) {
+        limbs.erase(limbs.begin(), limbs.begin() + (current - count));
+        if (is_zero()) {
+            negative = false;
+        }
+    }
+}
+
+bool BigFixed::is_zero() const {
+    return std::all_of(limbs.begin(), limbs.end(), [](uint32_t limb) { return limb == 0; });
+}
+
+double BigFixed::to_double() const {
+    // Three limbs from the most significant non-zero one hold more than the 53 bits of a double
+    int top = static_cast<int>(limbs.size()) - 1;
+    while (top > 0 && limbs[top] == 0) {
+        top--;
+    }
+    double value = 0.0;
+    for (int i = top; i >= std::max(0, top - 2); i--) {
+        value += std::ldexp(static_cast<double>(limbs[i]), 32 * (i - fraction_limbs()));
+    }
+    return negative ? -value : value;
+}
+
+FloatExp BigFixed::to_float_exp() const {
+    int top = static_cast<int>(limbs.size()) - 1;
+    while (top > 0 && limbs[top] == 0) {
+        top--;
+    }
+    double mantissa = 0.0;
+    for (int i = top; i >= std::max(0, top - 2); i--) {
+        mantissa += std::ldexp(static_cast<double>(limbs[i]), 32 * (i - top));
+    }
+    FloatExp value(mantissa, 32 * static_cast<int64_t>(top - fraction_limbs()));
+    return negative ? -value : value;
+}
+
+std::string BigFixed::to_string(int digits) const {
+    if (digits == 0) {
+        // 32 * log10(2) decimal digits per limb
+        digits = static_cast<int>(fraction_limbs() * 9.63);
+    }
+
+    std::string text = negative ? "-" : "";
+    text += std::to_string(limbs.back());
+    if (digits <= 0) {
+        return text;
+    }
+
+    text += '.';
+    std::vector<uint32_t> fraction(limbs.begin(), limbs.end() - 1);
+    for (int d = 0; d < digits; d++) {
+        uint64_t carry = 0;
+        for (uint32_t& limb : fraction) {
+            uint64_t product = static_cast<uint64_t>(limb) * 10 + carry;
+            limb = static_cast<uint32_t>(product);
+            carry = product >> 32;
+        }
+        text += static_cast<char>('0' + carry);
+    }
+    return text;
+}
+
+BigFixed& BigFixed::operator+=(const BigFixed& other) {
+    add_magnitude(other, negative != other.negative);
+    return *this;
+}
+
+BigFixed& BigFixed::operator-=(const BigFixed& other) {
+    add_magnitude(other, negative == other.negative);
+    return *this;
+}
+
+BigFixed BigFixed::operator-() const {
+    BigFixed result = *this;
+    result.negative = !negative && !is_zero();
+    return result;
+}
+
+void BigFixed::add_magnitude(const BigFixed& other, bool subtract) {
+    if (other.fraction_limbs() > fraction_limbs()) {
+        set_fraction_limbs(other.fraction_limbs());
+    }
+    // other's limb i lines up with our limb i + offset
+    size_t offset = limbs.size() - other.limbs.size();
+    auto other_limb = [&](size_t i) -> uint64_t { return i >= offset ? other.limbs[i - offset] : 0; };
+
+    if (!subtract) {
+        uint64_t carry = 0;
+        for (size_t i = 0; i < limbs.size(); i++) {
+            uint64_t sum = limbs[i] + other_limb(i) + carry;
+            limbs[i] = static_cast<uint32_t>(sum);
+            carry = sum >> 32;
+        }
+        return;
+    }
+
+    bool other_larger = false;
+    for (size_t i = limbs.size(); i-- > 0;) {
+        if (limbs[i] != other_limb(i)) {
+            other_larger = other_limb(i) > limbs[i];
+            break;
+        }
+    }
+
+    int64_t borrow = 0;
+    for (size_t i = 0; i < limbs.size(); i++) {
+        int64_t difference = other_larger ? static_cast<int64_t>(other_limb(i)) - limbs[i] - borrow
+                                          : static_cast<int64_t>(limbs[i]) - static_cast<int64_t>(other_limb(i)) - borrow;
+        borrow = difference < 0 ? 1 : 0;
+        limbs[i] = static_cast<uint32_t>(difference + (borrow << 32));
+    }
+    if (other_larger) {
+        negative = !negative;
+    }
+    if (is_zero()) {
+        negative = false;
+    }
+}
+
+namespace {
+
+int karatsuba_threshold = BigFixed::default_karatsuba_threshold;
+
+// out[0, 2n) = a[0, n) * b[0, n)
+void schoolbook_multiply(const uint32_t* a, const uint32_t* b, size_t n, uint32_t* out) {
+    std::fill(out, out + 2 * n, 0);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < n; j++) {
+            uint64_t t = static_cast<uint64_t>(a[i]) * b[j] + out[i + j] + carry;
+            out[i + j] = static_cast<uint32_t>(t);
+            carry = t >> 32;
+        }
+        out[i + n] = static_cast<uint32_t>(carry);
+    }
+}
+
+// out[0, 2n) = a[0, n)², every cross product a[i] * a[j] is computed once and doubled
+void schoolbook_square(const uint32_t* a, size_t n, uint32_t* out) {
+    std::fill(out, out + 2 * n, 0);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t carry = 0;
+        for (size_t j = i + 1; j < n; j++) {
+            uint64_t t = static_cast<uint64_t>(a[i]) * a[j] + out[i + j] + carry;
+            out[i + j] = static_cast<uint32_t>(t);
+            carry = t >> 32;
+        }
+        out[i + n] = static_cast<uint32_t>(carry);
+    }
+
+    uint32_t top_bit = 0;
+    for (size_t i = 0; i < 2 * n; i++) {
+        uint32_t limb = out[i];
+        out[i] = (limb << 1) | top_bit;
+        top_bit = limb >> 31;
+    }
+
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t square = static_cast<uint64_t>(a[i]) * a[i];
+        uint64_t low = static_cast<uint64_t>(out[2 * i]) + static_cast<uint32_t>(square) + carry;
+        out[2 * i] = static_cast<uint32_t>(low);
+        uint64_t high = static_cast<uint64_t>(out[2 * i + 1]) + (square >> 32) + (low >> 32);
+        out[2 * i + 1] = static_cast<uint32_t>(high);
+        carry = high >> 32;
+    }
+}
+
+// a[0, size) += b[0, count), the carry must not run past size
+void add_limbs(uint32_t* a, size_t size, const uint32_t* b, size_t count) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < size && (i < count || carry != 0); i++) {
+        uint64_t sum = static_cast<uint64_t>(a[i]) + (i < count ? b[i] : 0) + carry;
+        a[i] = static_cast<uint32_t>(sum);
+        carry = sum >> 32;
+    }
+}
+
+// a[0, size) -= b[0, count), the result must not be negative
+void subtract_limbs(uint32_t* a, size_t size, const uint32_t* b, size_t count) {
+    int64_t borrow = 0;
+    for (size_t i = 0; i < size && (i < count || borrow != 0); i++) {
+        int64_t difference = static_cast<int64_t>(a[i]) - (i < count ? b[i] : 0) - borrow;
+        borrow = difference < 0 ? 1 : 0;
+        a[i] = static_cast<uint32_t>(difference + (borrow << 32));
+    }
+}
+
+// out[0, 2n) = a[0, n) * b[0, n), or a[0, n)² when b is nullptr. Karatsuba splits a = a1 B + a0 and b = b1 B + b0
+// into halves and gets away with three half-size products: a0 b0, a1 b1 and (a0 + a1)(b0 + b1), whose difference to
+// the other two is the middle term a0 b1 + a1 b0.
+void multiply_limbs(const uint32_t* a, const uint32_t* b, size_t n, uint32_t* out) {
+    if (n < static_cast<size_t>(karatsuba_threshold)) {
+        if (b) {
+            schoolbook_multiply(a, b, n, out);
+        } else {
+            schoolbook_square(a, n, out);
+        }
+        return;
+    }
+
+    size_t low = n / 2;
+    size_t high = n - low;
+    multiply_limbs(a, b, low, out);
+    multiply_limbs(a + low, b ? b + low : nullptr, high, out + 2 * low);
+
+    // Both sums get a limb for their carry
+    std::vector<uint32_t> sums(2 * (high + 1), 0);
+    uint32_t* sum_a = sums.data();
+    uint32_t* sum_b = sums.data() + high + 1;
+    std::copy(a + low, a + n, sum_a);
+    add_limbs(sum_a, high + 1, a, low);
+    if (b) {
+        std::copy(b + low, b + n, sum_b);
+        add_limbs(sum_b, high + 1, b, low);
+    }
+
+    std::vector<uint32_t> middle(2 * (high + 1));
+    multiply_limbs(sum_a, b ? sum_b : nullptr, high + 1, middle.data());
+    subtract_limbs(middle.data(), middle.size(), out, 2 * low);
+    subtract_limbs(middle.data(), middle.size(), out + 2 * low, 2 * high);
+    add_limbs(out + low, 2 * n - low, middle.data(), middle.size());
+}
+
+}  // namespace
+
+void BigFixed::set_karatsuba_threshold(int limbs) { karatsuba_threshold = std::max(limbs, 4); }
+
+void BigFixed::multiply(const BigFixed& a, const BigFixed& b, BigFixed& result) {
+    if (a.fraction_limbs() != b.fraction_limbs()) {
+        // Products of mixed precision are rare, bring both to the higher one
+        int n = std::max(a.fraction_limbs(), b.fraction_limbs());
+        BigFixed x = a;
+        BigFixed y = b;
+        x.set_fraction_limbs(n);
+        y.set_fraction_limbs(n);
+        multiply(x, y, result);
+        return;
+    }
+    multiply_magnitudes(a, &b, result);
+    result.negative = (a.negative != b.negative) && !result.is_zero();
+}
+
+void BigFixed::square(const BigFixed& a, BigFixed& result) {
+    multiply_magnitudes(a, nullptr, result);
+    result.negative = false;
+}
+
+void BigFixed::multiply_magnitudes(const BigFixed& a, const BigFixed* b, BigFixed& result) {
+    // Product with 2n fractional limbs, of which the upper n are kept. One buffer per thread saves the allocation.
+    static thread_local std::vector<uint32_t> product;
+    size_t size = a.limbs.size();
+    product.resize(2 * size);
+    multiply_limbs(a.limbs.data(), b ? b->limbs.data() : nullptr, size, product.data());
+
+    size_t n = size - 1;
+    result.limbs.assign(product.begin() + n, product.begin() + n + size);
+}
+
+BigFixed operator*(const BigFixed& a, const BigFixed& b) {
+    BigFixed result;
+    BigFixed::multiply(a, b, result);
+    return result;
+}
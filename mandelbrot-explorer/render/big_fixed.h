@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "float_exp.h"
+
+// Signed fixed-point number with a 32-bit integer part and any number of 32-bit limbs after the binary point.
+// Everything the Mandelbrot iteration touches stays well below 2^31 in magnitude, so one integer limb is enough and
+// the precision can simply be chosen from the zoom. Operations on numbers of different precision work at the higher
+// one, and products are truncated toward zero to that precision.
+class BigFixed {
+   public:
+    // Zero with no fractional limbs
+    BigFixed() : limbs(1, 0) {}
+
+    // value must be smaller than 2^31 in magnitude, it is converted exactly when fraction_limbs >= 2
+    BigFixed(double value, int fraction_limbs) : BigFixed(FloatExp(value), fraction_limbs) {}
+
+    // value must be smaller than 2^31 in magnitude, it is rounded toward zero to fraction_limbs
+    BigFixed(const FloatExp& value, int fraction_limbs);
+
+    // Parses a decimal like "-0.743643887037158704752191506114774", rounding toward zero to fraction_limbs.
+    // Returns false if text is not a plain decimal number.
+    static bool parse(const std::string& text, int fraction_limbs, BigFixed& value);
+
+    // Exact value from count limbs, least significant first and the integer part last, as raw_limbs() gives them
+    static BigFixed from_raw_limbs(const uint32_t* limbs, int count, bool negative);
+
+    int fraction_limbs() const { return static_cast<int>(limbs.size()) - 1; }
+
+    const std::vector<uint32_t>& raw_limbs() const { return limbs; }
+
+    // Pads with zero limbs or truncates the lowest ones
+    void set_fraction_limbs(int count);
+
+    bool is_zero() const;
+    bool is_negative() const { return negative; }
+
+    double to_double() const;
+
+    // Keeps the exponent of differences far below the range of a double
+    FloatExp to_float_exp() const;
+
+    // digits == 0 prints every digit the fractional limbs can hold
+    std::string to_string(int digits = 0) const;
+
+    BigFixed& operator+=(const BigFixed& other);
+    BigFixed& operator-=(const BigFixed& other);
+    BigFixed operator-() const;
+
+    friend BigFixed operator+(BigFixed a, const BigFixed& b) { return a += b; }
+    friend BigFixed operator-(BigFixed a, const BigFixed& b) { return a -= b; }
+    friend BigFixed operator*(const BigFixed& a, const BigFixed& b);
+
+    // result = a * b, reusing the storage of result, which must be neither a nor b
+    static void multiply(const BigFixed& a, const BigFixed& b, BigFixed& result);
+
+    // result = a², which takes a little over half the work of multiply
+    static void square(const BigFixed& a, BigFixed& result);
+
+    // Products of at least this many limbs use Karatsuba instead of schoolbook multiplication. Below it, schoolbook
+    // is faster (see --bench orbit).
+    static constexpr int default_karatsuba_threshold = 48;
+    static void set_karatsuba_threshold(int limbs);
+
+   private:
+    // Magnitude of a * b, or of a² when b is nullptr, at the precision of a, which b must share
+    static void multiply_magnitudes(const BigFixed& a, const BigFixed* b, BigFixed& result);
+
+    // Adds the magnitude of other to ours, or subtracts it when subtract is set, keeping our sign unless the
+    // subtraction crosses zero
+    void add_magnitude(const BigFixed& other, bool subtract);
+
+    // limbs[0] is the least significant fractional limb, limbs.back() the integer part
+    std::vector<uint32_t> limbs;
+    bool negative = false;
+};
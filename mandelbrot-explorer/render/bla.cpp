@@ -0,0 +1,65 @@
+#include "bla.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Largest error of a step relative to the offset it produces. At the rounding error of a double, frames come out the
+// same as when every iteration is computed.
+constexpr double bla_tolerance = 1.0 / (1ull << 53);
+
+// Step x followed by step y
+BlaStep merge(const BlaStep& x, const BlaStep& y, const FloatExp& max_dc) {
+    BlaStep step;
+    step.a_x = y.a_x * x.a_x - y.a_y * x.a_y;
+    step.a_y = y.a_x * x.a_y + y.a_y * x.a_x;
+    step.b_x = y.a_x * x.b_x - y.a_y * x.b_y + y.b_x;
+    step.b_y = y.a_x * x.b_y + y.a_y * x.b_x + y.b_y;
+
+    // x has to hold at the start, and the offset x leads to, |A_x dz + B_x dc|, has to stay within y's radius.
+    // Coefficients that overflow belong to steps far too long for any offset.
+    double a_x_norm = std::hypot(x.a_x, x.a_y);
+    double b_x_norm = std::hypot(x.b_x, x.b_y);
+    FloatExp y_radius;
+    if (a_x_norm > 0.0 && std::isfinite(a_x_norm) && std::isfinite(b_x_norm) && std::isfinite(step.a_x) &&
+        std::isfinite(step.a_y) && std::isfinite(step.b_x) && std::isfinite(step.b_y)) {
+        y_radius = std::max(FloatExp(), (y.radius - b_x_norm * max_dc) / a_x_norm);
+    }
+    step.radius = std::min(x.radius, y_radius);
+    step.radius_squared = (step.radius * step.radius).to_double();
+    return step;
+}
+
+}  // namespace
+
+BlaTable::BlaTable(const ReferenceOrbit& orbit, const FloatExp& max_dc) {
+    // Single iterations: dz_{n+1} = 2 Z_n dz_n + dz_n² + dc, where dz_n² is negligible next to 2 Z_n dz_n while
+    // |dz_n| < tolerance * |2 Z_n|. A step must not skip past the iteration a pixel escapes at either, so it also
+    // needs |Z_{n+1}| + |2 Z_n| |dz_n| + |dc| <= 2, and merged steps inherit that for every iteration they cover. The
+    // last point is where the reference escaped, or the end of the orbit.
+    int last = static_cast<int>(orbit.points.size()) - 1;
+    std::vector<BlaStep> singles;
+    for (int n = 1; n < last; n++) {
+        const OrbitPoint& z = orbit.points[n];
+        const OrbitPoint& next = orbit.points[n + 1];
+        BlaStep step = {2.0 * z.x, 2.0 * z.y, 1.0, 0.0, FloatExp(), 0.0};
+        double a_norm = std::hypot(step.a_x, step.a_y);
+        if (a_norm > 0.0) {
+            FloatExp escape_radius = (FloatExp(2.0 - std::hypot(next.x, next.y)) - max_dc) / a_norm;
+            step.radius = std::max(FloatExp(), std::min(FloatExp(bla_tolerance * a_norm), escape_radius));
+        }
+        step.radius_squared = (step.radius * step.radius).to_double();
+        singles.push_back(step);
+    }
+    levels.push_back(std::move(singles));
+
+    while (levels.back().size() >= 2) {
+        const std::vector<BlaStep>& below = levels.back();
+        std::vector<BlaStep> level;
+        for (size_t i = 0; i + 1 < below.size(); i += 2) {
+            level.push_back(merge(below[i], below[i + 1], max_dc));
+        }
+        levels.push_back(std::move(level));
+    }
+}
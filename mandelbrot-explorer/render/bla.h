@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include "float_exp.h"
+#include "perturbation.h"
+
+// Skips `length` iterations of the offset from reference iteration n: dz_{n+length} = A dz_n + B dc, which holds as
+// long as |dz_n| < radius
+struct BlaStep {
+    double a_x, a_y;
+    double b_x, b_y;
+    // Far below the range of a double in deep views, radius_squared is radius² rounded to double, 0 if it underflows
+    FloatExp radius;
+    double radius_squared;
+};
+
+// Bilinear approximation table of a reference orbit. While the offset is small next to the reference, its squared
+// term is negligible and many iterations collapse into one complex multiply-add. Level k holds the steps of 2^k
+// iterations that start at reference iterations 1, 1 + 2^k, 1 + 2 * 2^k, ..., each one merged from two steps of the
+// level below.
+class BlaTable {
+   public:
+    // max_dc is the largest |dc| of the pixels that will use the table
+    BlaTable(const ReferenceOrbit& orbit, const FloatExp& max_dc);
+
+    // Longest step from reference iteration n that holds for an offset with |dz|² = dz_norm and skips at most
+    // max_length iterations, nullptr when not even one iteration can be skipped. Real is double or FloatExp.
+    template <typename Real>
+    const BlaStep* find(int n, const Real& dz_norm, int max_length, int& length) const {
+        // Merged steps never hold further than their first single step, which rules out most calls
+        size_t start = static_cast<size_t>(n - 1);
+        if (start >= levels[0].size() || !holds(levels[0][start], dz_norm)) {
+            return nullptr;
+        }
+
+        // Level k only has steps from reference iterations n with n - 1 divisible by 2^k
+        for (int level = static_cast<int>(levels.size()) - 1; level >= 0; level--) {
+            int step_length = 1 << level;
+            if ((start & (step_length - 1)) != 0 || step_length > max_length) {
+                continue;
+            }
+            size_t index = start >> level;
+            if (index < levels[level].size() && holds(levels[level][index], dz_norm)) {
+                length = step_length;
+                return &levels[level][index];
+            }
+        }
+        return nullptr;
+    }
+
+   private:
+    static bool holds(const BlaStep& step, double dz_norm) { return dz_norm < step.radius_squared; }
+    static bool holds(const BlaStep& step, const FloatExp& dz_norm) { return dz_norm < step.radius * step.radius; }
+
+    std::vector<std::vector<BlaStep>> levels;
+};
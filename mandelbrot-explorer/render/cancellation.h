@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Counts the views handed to a renderer. Advancing it cancels every token taken before, so whoever publishes a newer
+// view tells the render still working on an older one to stop.
+class RenderGeneration {
+   public:
+    void advance() { generation.fetch_add(1, std::memory_order_relaxed); }
+    uint64_t current() const { return generation.load(std::memory_order_relaxed); }
+
+   private:
+    std::atomic<uint64_t> generation{0};
+};
+
+// Tells a render whether the view it works on is still the newest. Tiles look at it between chunks of rows, which
+// costs one relaxed load each. A default constructed token is never cancelled.
+class CancellationToken {
+   public:
+    CancellationToken() = default;
+    explicit CancellationToken(const RenderGeneration& source) : source(&source), generation(source.current()) {}
+
+    bool can_cancel() const { return source != nullptr; }
+    bool cancelled() const { return source != nullptr && source->current() != generation; }
+
+   private:
+    const RenderGeneration* source = nullptr;
+    uint64_t generation = 0;
+};
@@ -0,0 +1,69 @@
+#include "cpu_features.h"
+
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+SimdLevel detect_simd_level() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!sse2) return SimdLevel::Scalar;
+    if (!osxsave || max_leaf < 7) return SimdLevel::SSE2;
+
+    // The OS has to save the YMM (and for AVX-512 the opmask and ZMM) registers on context switches
+    unsigned long long xcr0 = _xgetbv(0);
+    bool ymm_enabled = (xcr0 & 0x6) == 0x6;
+    bool zmm_enabled = (xcr0 & 0xe6) == 0xe6;
+
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    bool avx512f = (info[1] & (1 << 16)) != 0;
+
+    if (avx512f && zmm_enabled) return SimdLevel::AVX512;
+    if (avx2 && fma && ymm_enabled) return SimdLevel::AVX2;
+    return SimdLevel::SSE2;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    // Also checks that the OS enabled the extended register state
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+    return SimdLevel::Scalar;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SSE2:
+            return "sse2";
+        case SimdLevel::AVX2:
+            return "avx2";
+        case SimdLevel::AVX512:
+            return "avx512";
+        default:
+            return "scalar";
+    }
+}
+
+bool parse_simd_level(const char* name, SimdLevel& level) {
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512};
+    for (SimdLevel candidate : levels) {
+        if (std::strcmp(name, simd_level_name(candidate)) == 0) {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
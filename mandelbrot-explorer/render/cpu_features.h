@@ -0,0 +1,12 @@
+#pragma once
+
+// Instruction sets the escape-time kernels are compiled for, in increasing order of width.
+enum class SimdLevel { Scalar, SSE2, AVX2, AVX512 };
+
+// Widest level the CPU and operating system support, detected with CPUID.
+SimdLevel detect_simd_level();
+
+const char* simd_level_name(SimdLevel level);
+
+// Parses "scalar", "sse2", "avx2" or "avx512", returns false for anything else.
+bool parse_simd_level(const char* name, SimdLevel& level);
@@ -0,0 +1,587 @@
+#include "cpu_renderer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+
+#include "bla.h"
+#include "palette.h"
+
+namespace {
+
+// Rows a cancellable frame renders between two looks at its token, a few milliseconds of work at deep zooms
+const int cancel_check_rows = 4;
+
+// The vertex shader passes the quad position through, so a fragment at the pixel center sees
+// coord in [-1, 1] with y pointing up.
+float pixel_coord_x(int x, int width) { return 2.0f * (static_cast<float>(x) + 0.5f) / width - 1.0f; }
+
+float pixel_coord_y(int row, int height) { return 1.0f - 2.0f * (static_cast<float>(row) + 0.5f) / height; }
+
+// Calls row_kernel(cx, cy, count, out) for every row of tile the grid covers, with the centers of just the pixels the
+// grid takes. cx holds the center of every column of the tile, row_center(row) gives cy.
+template <typename T, typename RowCenter, typename RowKernel>
+void iterate_rows(const RenderParams& params, const Tile& tile, const PassGrid& grid, const std::vector<T>& cx,
+                  RowCenter row_center, RowKernel row_kernel, uint32_t* iterations) {
+    int span = tile.x1 - tile.x0;
+    std::vector<T> sampled_cx;
+    std::vector<uint32_t> sampled_out;
+    for (int row = tile.y0; row < tile.y1; row++) {
+        if (!grid.covers_row(row)) continue;
+        uint32_t* out = iterations + static_cast<size_t>(row) * params.width + tile.x0;
+        if (grid.whole_frame()) {
+            row_kernel(cx.data(), row_center(row), span, out);
+            continue;
+        }
+
+        int first = grid.first_column(row, tile.x0) - tile.x0;
+        int step = grid.column_step(row);
+        sampled_cx.clear();
+        for (int x = first; x < span; x += step) {
+            sampled_cx.push_back(cx[x]);
+        }
+        sampled_out.resize(sampled_cx.size());
+        row_kernel(sampled_cx.data(), row_center(row), static_cast<int>(sampled_cx.size()), sampled_out.data());
+        for (size_t i = 0; i < sampled_out.size(); i++) {
+            out[first + i * step] = sampled_out[i];
+        }
+    }
+}
+
+// Iterates the tile whose pixel centers are (cx[x - tile.x0], cy[row - tile.y0])
+template <typename T>
+void iterate_tile(const RenderParams& params, void (*row_kernel)(const T*, T, int, int, uint32_t*),
+                  void (*refill_kernel)(const T*, const T*, int, int, uint32_t*), const Tile& tile,
+                  const PassGrid& grid, const std::vector<T>& cx, const std::vector<T>& cy, uint32_t* iterations) {
+    if (!refill_kernel) {
+        iterate_rows(
+            params, tile, grid, cx, [&](int row) { return cy[row - tile.y0]; },
+            [&](const T* row_cx, T row_cy, int count, uint32_t* out) {
+                row_kernel(row_cx, row_cy, count, params.max_iterations, out);
+            },
+            iterations);
+        return;
+    }
+
+    std::vector<T> point_cx;
+    std::vector<T> point_cy;
+    std::vector<size_t> point_index;
+    for (int row = tile.y0; row < tile.y1; row++) {
+        if (!grid.covers_row(row)) continue;
+        for (int x = grid.first_column(row, tile.x0); x < tile.x1; x += grid.column_step(row)) {
+            point_cx.push_back(cx[x - tile.x0]);
+            point_cy.push_back(cy[row - tile.y0]);
+            point_index.push_back(static_cast<size_t>(row) * params.width + x);
+        }
+    }
+
+    std::vector<uint32_t> point_out(point_cx.size());
+    refill_kernel(point_cx.data(), point_cy.data(), static_cast<int>(point_cx.size()), params.max_iterations,
+                  point_out.data());
+
+    for (size_t i = 0; i < point_out.size(); i++) {
+        iterations[point_index[i]] = point_out[i];
+    }
+}
+
+// Rounds value to the nearest double, then the rest of it, and so on
+template <int N>
+MultiDouble<N> to_multi_double(const BigFixed& value) {
+    MultiDouble<N> result;
+    BigFixed rest = value;
+    for (int k = 0; k < N; k++) {
+        result.x[k] = rest.to_double();
+        rest -= BigFixed(result.x[k], rest.fraction_limbs());
+    }
+    return result;
+}
+
+// The pixel offsets from the center are exact enough in double, only their sum with the center needs the precision
+template <int N>
+void iterate_multi_double_tile(const RenderParams& params,
+                               void (*row_kernel)(const MultiDouble<N>*, const MultiDouble<N>&, int, int, uint32_t*),
+                               const Tile& tile, const PassGrid& grid, uint32_t* iterations) {
+    MultiDouble<N> center_x = to_multi_double<N>(params.center_x);
+    MultiDouble<N> center_y = to_multi_double<N>(params.center_y);
+    double zoom = params.zoom.to_double();
+    float inverse_aspect = 1.0f / params.aspectRatio;
+
+    std::vector<MultiDouble<N>> cx(tile.x1 - tile.x0);
+    for (int x = tile.x0; x < tile.x1; x++) {
+        MultiDouble<N> offset{};
+        offset.x[0] = static_cast<double>(pixel_coord_x(x, params.width)) / zoom;
+        cx[x - tile.x0] = center_x + offset;
+    }
+    iterate_rows(
+        params, tile, grid, cx,
+        [&](int row) {
+            MultiDouble<N> offset{};
+            offset.x[0] = static_cast<double>(pixel_coord_y(row, params.height) * inverse_aspect) / zoom;
+            return center_y + offset;
+        },
+        [&](const MultiDouble<N>* row_cx, const MultiDouble<N>& row_cy, int count, uint32_t* out) {
+            row_kernel(row_cx, row_cy, count, params.max_iterations, out);
+        },
+        iterations);
+}
+
+// Truncated toward zero to 124 fraction bits. Magnitudes of 4 and more become 4, which escapes right away like the
+// point itself.
+Fixed128 to_fixed128(BigFixed value) {
+    value.set_fraction_limbs(std::max(value.fraction_limbs(), 4));
+    const std::vector<uint32_t>& limbs = value.raw_limbs();
+    size_t top = limbs.size() - 1;
+    Fixed128 magnitude = Fixed128::from_int(4);
+    if (limbs[top] < 4) {
+        uint64_t f2 = limbs[top - 2];
+        magnitude.hi = (static_cast<uint64_t>(limbs[top]) << 60) | (static_cast<uint64_t>(limbs[top - 1]) << 28) |
+                       (f2 >> 4);
+        magnitude.lo = (f2 << 60) | (static_cast<uint64_t>(limbs[top - 3]) << 28) | (limbs[top - 4] >> 4);
+    }
+    return value.is_negative() ? -magnitude : magnitude;
+}
+
+// Both pixel offsets are integer multiples of 1 / (zoom * width), 2x + 1 - width of them for x and
+// height - 2 row - 1 for y (coord.y / aspectRatio, with aspectRatio = width / height). Past the multiply and division
+// for that step, which IEEE 754 rounds the same way everywhere, c is computed in integers, so the frame is the same
+// on every build.
+void iterate_fixed128_tile(const RenderParams& params, const Tile& tile, const PassGrid& grid, uint32_t* iterations) {
+    const int fraction_limbs = 5;
+    BigFixed step(FloatExp(1.0) / (params.zoom * FloatExp(params.width)), fraction_limbs);
+
+    std::vector<Fixed128> cx(tile.x1 - tile.x0);
+    for (int x = tile.x0; x < tile.x1; x++) {
+        BigFixed offset = BigFixed(2.0 * x + 1 - params.width, fraction_limbs) * step;
+        cx[x - tile.x0] = to_fixed128(params.center_x + offset);
+    }
+    iterate_rows(
+        params, tile, grid, cx,
+        [&](int row) {
+            BigFixed offset = BigFixed(params.height - 2.0 * row - 1, fraction_limbs) * step;
+            return to_fixed128(params.center_y + offset);
+        },
+        [&](const Fixed128* row_cx, Fixed128 row_cy, int count, uint32_t* out) {
+            escape_fixed128(row_cx, row_cy, count, params.max_iterations, out);
+        },
+        iterations);
+}
+
+// Whether every pixel of a and b comes out the same
+bool same_frame(const RenderParams& a, const RenderParams& b) {
+    return a.width == b.width && a.height == b.height && !(a.zoom < b.zoom) && !(b.zoom < a.zoom) &&
+           a.pan_x == b.pan_x && a.pan_y == b.pan_y && a.aspectRatio == b.aspectRatio &&
+           a.max_iterations == b.max_iterations && a.use_double_precision == b.use_double_precision &&
+           a.use_perturbation == b.use_perturbation && a.extended_precision == b.extended_precision &&
+           a.center_x.fraction_limbs() == b.center_x.fraction_limbs() &&
+           a.center_y.fraction_limbs() == b.center_y.fraction_limbs() && (a.center_x - b.center_x).is_zero() &&
+           (a.center_y - b.center_y).is_zero();
+}
+
+// The rows of tiles that rows_done does not mark, as tiles of consecutive rows
+std::vector<Tile> unfinished_tiles(const std::vector<Tile>& tiles, const std::vector<uint8_t>& rows_done,
+                                   int columns) {
+    std::vector<Tile> unfinished;
+    for (const Tile& tile : tiles) {
+        const uint8_t* done = rows_done.data() + tile.x0 / CpuRenderer::tile_size;
+        int row = tile.y0;
+        while (row < tile.y1) {
+            if (done[static_cast<size_t>(row) * columns]) {
+                row++;
+                continue;
+            }
+            int first = row;
+            while (row < tile.y1 && !done[static_cast<size_t>(row) * columns]) {
+                row++;
+            }
+            unfinished.push_back({tile.x0, first, tile.x1, row});
+        }
+    }
+    return unfinished;
+}
+
+}  // namespace
+
+bool pixel_shift(const RenderParams& a, const RenderParams& b, int& dx, int& dy) {
+    if (a.width != b.width || a.height != b.height || a.zoom < b.zoom || b.zoom < a.zoom ||
+        a.aspectRatio != b.aspectRatio || a.max_iterations != b.max_iterations ||
+        a.use_double_precision != b.use_double_precision || a.use_perturbation != b.use_perturbation ||
+        a.extended_precision != b.extended_precision) {
+        return false;
+    }
+
+    // A pixel is 2 / (zoom * width) wide and 2 / (zoom * height * aspectRatio) high, rows run downward
+    double shift_x;
+    double shift_y;
+    if (b.use_perturbation || b.extended_precision != ExtendedPrecision::None) {
+        shift_x = ((b.center_x - a.center_x).to_float_exp() * b.zoom).to_double();
+        shift_y = ((b.center_y - a.center_y).to_float_exp() * b.zoom).to_double();
+    } else {
+        double zoom = b.zoom.to_double();
+        shift_x = (b.pan_x - a.pan_x) * zoom;
+        shift_y = (b.pan_y - a.pan_y) * zoom;
+    }
+    shift_x *= b.width / 2.0;
+    shift_y *= -b.height * static_cast<double>(b.aspectRatio) / 2.0;
+
+    dx = static_cast<int>(std::lround(shift_x));
+    dy = static_cast<int>(std::lround(shift_y));
+    return std::fabs(shift_x - dx) < 1e-3 && std::fabs(shift_y - dy) < 1e-3 && std::abs(dx) < b.width &&
+           std::abs(dy) < b.height;
+}
+
+std::vector<Tile> split_into_tiles(int width, int height, int tile_size) {
+    std::vector<Tile> tiles;
+    for (int y = 0; y < height; y += tile_size) {
+        for (int x = 0; x < width; x += tile_size) {
+            tiles.push_back({x, y, std::min(x + tile_size, width), std::min(y + tile_size, height)});
+        }
+    }
+    return tiles;
+}
+
+void render_tile(const RenderParams& params, const EscapeKernels& kernels, bool lane_refill, const Tile& tile,
+                 uint32_t* iterations, const PassGrid& grid) {
+    if (!grid.covers_rows(tile.y0, tile.y1)) return;
+    // vec2(coord.x, coord.y * (1.0 / aspectRatio)), the y scale is computed in float in both shaders
+    float inverse_aspect = 1.0f / params.aspectRatio;
+    int span = tile.x1 - tile.x0;
+
+    if (params.extended_precision == ExtendedPrecision::DoubleDouble) {
+        iterate_multi_double_tile(params, kernels.iterate_double_double, tile, grid, iterations);
+    } else if (params.extended_precision == ExtendedPrecision::QuadDouble) {
+        iterate_multi_double_tile(params, kernels.iterate_quad_double, tile, grid, iterations);
+    } else if (params.extended_precision == ExtendedPrecision::Fixed128) {
+        iterate_fixed128_tile(params, tile, grid, iterations);
+    } else if (params.use_double_precision) {
+        double zoom = params.zoom.to_double();
+        std::vector<double> cx(span);
+        for (int x = tile.x0; x < tile.x1; x++) {
+            cx[x - tile.x0] = static_cast<double>(pixel_coord_x(x, params.width)) / zoom + params.pan_x;
+        }
+        std::vector<double> cy(tile.y1 - tile.y0);
+        for (int row = tile.y0; row < tile.y1; row++) {
+            float coord_y = pixel_coord_y(row, params.height) * inverse_aspect;
+            cy[row - tile.y0] = static_cast<double>(coord_y) / zoom + params.pan_y;
+        }
+        iterate_tile(params, kernels.iterate_double, lane_refill ? kernels.refill_double : nullptr, tile, grid, cx, cy,
+                     iterations);
+    } else {
+        // glUniform1f / glUniform2f narrow the double globals to float
+        float zoom = static_cast<float>(params.zoom.to_double());
+        std::vector<float> cx(span);
+        for (int x = tile.x0; x < tile.x1; x++) {
+            cx[x - tile.x0] = pixel_coord_x(x, params.width) / zoom + static_cast<float>(params.pan_x);
+        }
+        std::vector<float> cy(tile.y1 - tile.y0);
+        for (int row = tile.y0; row < tile.y1; row++) {
+            float coord_y = pixel_coord_y(row, params.height) * inverse_aspect;
+            cy[row - tile.y0] = coord_y / zoom + static_cast<float>(params.pan_y);
+        }
+        iterate_tile(params, kernels.iterate_float, lane_refill ? kernels.refill_float : nullptr, tile, grid, cx, cy,
+                     iterations);
+    }
+}
+
+void colorize(const uint32_t* iterations, size_t pixel_count, int max_iterations, uint8_t* rgba) {
+    std::vector<uint32_t> palette = build_palette(max_iterations);
+    for (size_t i = 0; i < pixel_count; i++) {
+        uint32_t color = palette[std::min<uint32_t>(iterations[i], max_iterations)];
+        rgba[4 * i + 0] = static_cast<uint8_t>(color);
+        rgba[4 * i + 1] = static_cast<uint8_t>(color >> 8);
+        rgba[4 * i + 2] = static_cast<uint8_t>(color >> 16);
+        rgba[4 * i + 3] = static_cast<uint8_t>(color >> 24);
+    }
+}
+
+void colorize_samples(const uint32_t* iterations, int width, int height, int spacing, int max_iterations,
+                      uint8_t* rgba) {
+    std::vector<uint32_t> palette = build_palette(max_iterations);
+    for (int y = 0; y < height; y++) {
+        const uint32_t* samples = iterations + static_cast<size_t>(y - y % spacing) * width;
+        uint8_t* out = rgba + static_cast<size_t>(y) * width * 4;
+        for (int x = 0; x < width; x++) {
+            uint32_t color = palette[std::min<uint32_t>(samples[x - x % spacing], max_iterations)];
+            out[4 * x + 0] = static_cast<uint8_t>(color);
+            out[4 * x + 1] = static_cast<uint8_t>(color >> 8);
+            out[4 * x + 2] = static_cast<uint8_t>(color >> 16);
+            out[4 * x + 3] = static_cast<uint8_t>(color >> 24);
+        }
+    }
+}
+
+CpuRenderer::CpuRenderer(unsigned thread_count)
+    : pool(thread_count), scheduler(pool), kernels(&get_escape_kernels(detect_simd_level())) {}
+
+bool CpuRenderer::render_iterations(const RenderParams& params, std::vector<uint32_t>& iterations,
+                                    const CancellationToken& cancel) {
+    return render_passes(params, 1, iterations, cancel, nullptr);
+}
+
+bool CpuRenderer::render_progressive(const RenderParams& params, const PresentFunction& present,
+                                     const CancellationToken& cancel) {
+    std::vector<uint32_t> iterations;
+    std::vector<uint8_t> rgba(static_cast<size_t>(params.width) * params.height * 4);
+    return render_passes(params, progressive_spacing, iterations, cancel, [&](int spacing) {
+        colorize_samples(iterations.data(), params.width, params.height, spacing, params.max_iterations, rgba.data());
+        present(rgba, spacing);
+    });
+}
+
+bool CpuRenderer::render_passes(const RenderParams& params, int first_spacing, std::vector<uint32_t>& iterations,
+                                const CancellationToken& cancel, const std::function<void(int)>& pass_done) {
+    int columns = (params.width + tile_size - 1) / tile_size;
+    bool resume = partial.valid && partial.first_spacing == first_spacing && same_frame(partial.params, params);
+    if (resume) {
+        iterations.swap(partial.iterations);
+    } else {
+        iterations.resize(static_cast<size_t>(params.width) * params.height);
+        partial.params = params;
+        bool reprojected = reproject(params, iterations, partial.regions);
+        partial.first_spacing = first_spacing;
+        // The strips reprojection leaves are rendered in one pass, coarse previews would blur the shifted pixels
+        partial.start_spacing = reprojected ? 1 : first_spacing;
+        partial.spacing = partial.start_spacing;
+        last_computed_pixels = 0;
+        for (const Tile& region : partial.regions) {
+            last_computed_pixels += region.pixel_count();
+        }
+        partial.rows_done.assign(static_cast<size_t>(params.height) * columns, 0);
+        partial.passes_done = false;
+        if (params.use_perturbation) {
+            partial.glitched.assign(iterations.size(), 0);
+            perturbation = PerturbationStats();
+            perturbation.references = 1;
+        }
+    }
+    partial.valid = false;
+
+    std::vector<Tile> tiles = split_into_tiles(params.width, params.height, tile_size);
+    std::unique_ptr<BlaTable> bla;
+    if (params.use_perturbation && !partial.passes_done) {
+        update_reference_orbit(params);
+        if (bilinear_approximation) {
+            bla = std::make_unique<BlaTable>(reference, max_pixel_offset(params, reference));
+        }
+    }
+
+    bool complete = true;
+    while (!partial.passes_done) {
+        PassGrid grid = {partial.spacing, partial.spacing == partial.start_spacing};
+        std::vector<Tile> pass_tiles = unfinished_tiles(partial.regions, partial.rows_done, columns);
+        if (params.use_perturbation) {
+            complete = render_perturbation_pass(params, reference, bla.get(), pass_tiles, grid, false, iterations,
+                                                cancel);
+        } else {
+            complete = run_tiles(pass_tiles, cancel, true, [&](const Tile& tile) {
+                render_tile(params, *kernels, lane_refill, tile, iterations.data(), grid);
+                uint64_t tile_iterations = 0;
+                for (int row = tile.y0; row < tile.y1; row++) {
+                    if (!grid.covers_row(row)) continue;
+                    const uint32_t* out = iterations.data() + static_cast<size_t>(row) * params.width;
+                    for (int x = grid.first_column(row, tile.x0); x < tile.x1; x += grid.column_step(row)) {
+                        tile_iterations += out[x];
+                    }
+                }
+                return tile_iterations;
+            });
+        }
+        if (!complete) break;
+
+        if (partial.spacing == 1) {
+            partial.passes_done = true;
+            break;
+        }
+        partial.spacing /= 2;
+        partial.rows_done.assign(partial.rows_done.size(), 0);
+        if (pass_done && !cancel.cancelled()) {
+            pass_done(partial.spacing * 2);
+        }
+    }
+
+    if (complete && params.use_perturbation) {
+        perturbation.glitched_pixels = std::count(partial.glitched.begin(), partial.glitched.end(), 1);
+        complete = resolve_glitches(params, tiles, iterations, cancel);
+    }
+
+    if (!complete) {
+        partial.iterations = iterations;
+        partial.valid = true;
+        return false;
+    }
+    if (reprojection) {
+        previous.params = params;
+        previous.iterations = iterations;
+        previous.valid = true;
+    }
+    if (pass_done) {
+        pass_done(1);
+    }
+    return true;
+}
+
+bool CpuRenderer::reproject(const RenderParams& params, std::vector<uint32_t>& iterations,
+                            std::vector<Tile>& regions) {
+    regions = split_into_tiles(params.width, params.height, tile_size);
+    int dx;
+    int dy;
+    if (!reprojection || !previous.valid || !pixel_shift(previous.params, params, dx, dy)) {
+        return false;
+    }
+
+    // Pixels whose source lies inside the last frame
+    int x0 = std::max(0, -dx);
+    int x1 = std::min(params.width, params.width - dx);
+    int y0 = std::max(0, -dy);
+    int y1 = std::min(params.height, params.height - dy);
+    for (int y = y0; y < y1; y++) {
+        const uint32_t* source = previous.iterations.data() + static_cast<size_t>(y + dy) * params.width + dx;
+        std::copy(source + x0, source + x1, iterations.data() + static_cast<size_t>(y) * params.width + x0);
+    }
+
+    // A pan uncovers at most one side in each direction, so every tile is left with full rows above or below the
+    // shifted pixels and a part of the rows beside them, never sharing a row
+    std::vector<Tile> tiles;
+    tiles.swap(regions);
+    for (const Tile& tile : tiles) {
+        if (tile.y0 < y0) {
+            regions.push_back({tile.x0, tile.y0, tile.x1, std::min(tile.y1, y0)});
+        }
+        if (tile.y1 > y1) {
+            regions.push_back({tile.x0, std::max(tile.y0, y1), tile.x1, tile.y1});
+        }
+        int rows_y0 = std::max(tile.y0, y0);
+        int rows_y1 = std::min(tile.y1, y1);
+        if (rows_y0 >= rows_y1) continue;
+        if (tile.x0 < x0) {
+            regions.push_back({tile.x0, rows_y0, std::min(tile.x1, x0), rows_y1});
+        }
+        if (tile.x1 > x1) {
+            regions.push_back({std::max(tile.x0, x1), rows_y0, tile.x1, rows_y1});
+        }
+    }
+    return true;
+}
+
+bool CpuRenderer::run_tiles(const std::vector<Tile>& tiles, const CancellationToken& cancel, bool track_rows,
+                            const std::function<uint64_t(const Tile&)>& render_rows) {
+    int columns = (partial.params.width + tile_size - 1) / tile_size;
+    // The scheduler never hands out more than tile_size rows, frames that cannot be cancelled render them in one go
+    int chunk_rows = cancel.can_cancel() ? cancel_check_rows : tile_size;
+    std::atomic<bool> interrupted{false};
+    scheduler.run(tiles, [&](const Tile& tile) {
+        uint64_t tile_iterations = 0;
+        for (int y0 = tile.y0; y0 < tile.y1; y0 += chunk_rows) {
+            if (cancel.cancelled()) {
+                interrupted = true;
+                break;
+            }
+            Tile rows = {tile.x0, y0, tile.x1, std::min(y0 + chunk_rows, tile.y1)};
+            tile_iterations += render_rows(rows);
+            if (track_rows) {
+                for (int row = rows.y0; row < rows.y1; row++) {
+                    partial.rows_done[static_cast<size_t>(row) * columns + tile.x0 / tile_size] = 1;
+                }
+            }
+        }
+        return tile_iterations;
+    });
+    return !interrupted;
+}
+
+bool CpuRenderer::render_perturbation_pass(const RenderParams& params, const ReferenceOrbit& orbit,
+                                           const BlaTable* bla, const std::vector<Tile>& tiles, const PassGrid& grid,
+                                           bool only_glitched, std::vector<uint32_t>& iterations,
+                                           const CancellationToken& cancel) {
+    std::atomic<uint64_t> total_iterations{0};
+    std::atomic<uint64_t> skipped_iterations{0};
+    bool complete = run_tiles(tiles, cancel, !only_glitched, [&](const Tile& tile) {
+        uint64_t skipped = 0;
+        uint64_t tile_iterations = render_perturbation_tile(params, orbit, bla, tile, grid, only_glitched,
+                                                            iterations.data(), partial.glitched.data(), skipped);
+        total_iterations += tile_iterations;
+        skipped_iterations += skipped;
+        // Skipped iterations cost next to nothing, the scheduler only wants to know about the others
+        return tile_iterations - skipped;
+    });
+    perturbation.iterations += total_iterations;
+    perturbation.skipped_iterations += skipped_iterations;
+    return complete;
+}
+
+bool CpuRenderer::resolve_glitches(const RenderParams& params, const std::vector<Tile>& tiles,
+                                   std::vector<uint32_t>& iterations, const CancellationToken& cancel) {
+    std::vector<uint8_t>& glitched = partial.glitched;
+    int x;
+    int y;
+    while (find_glitch_reference(glitched.data(), iterations.data(), params.width, params.height, x, y)) {
+        if (perturbation.references == max_references) {
+            perturbation.unresolved_pixels = std::count(glitched.begin(), glitched.end(), 1);
+            break;
+        }
+        if (cancel.cancelled()) {
+            return false;
+        }
+
+        BigFixed c_x;
+        BigFixed c_y;
+        pixel_position(params, x, y, c_x, c_y);
+        ReferenceOrbit secondary = find_reference_orbit(c_x, c_y, params.max_iterations);
+        std::unique_ptr<BlaTable> bla;
+        if (bilinear_approximation) {
+            bla = std::make_unique<BlaTable>(secondary, max_pixel_offset(params, secondary));
+        }
+        // A pass the token stopped leaves the pixels it did not reach glitched, and is not counted
+        if (!render_perturbation_pass(params, secondary, bla.get(), tiles, PassGrid(), true, iterations, cancel)) {
+            return false;
+        }
+        perturbation.references++;
+        perturbation.rerender_passes++;
+
+        // In chaotic spots even the reference pixel's own tiny offset can drift off the orbit, but the orbit is
+        // the answer for that pixel. Resolving it here guarantees that every pass makes progress.
+        size_t index = static_cast<size_t>(y) * params.width + x;
+        if (glitched[index]) {
+            iterations[index] = static_cast<uint32_t>(secondary.escape_iteration());
+            glitched[index] = 0;
+        }
+    }
+    return true;
+}
+
+bool CpuRenderer::update_reference_orbit(const RenderParams& params) {
+    int fraction_limbs = reference_fraction_limbs(params.zoom, params.width);
+    if (reference.max_iterations == params.max_iterations && reference.c_x.fraction_limbs() >= fraction_limbs) {
+        // Distance from the view center in coord units, the view spans [-1, 1] horizontally
+        double offset_x = ((params.center_x - reference.c_x).to_float_exp() * params.zoom).to_double();
+        double offset_y = ((params.center_y - reference.c_y).to_float_exp() * params.zoom).to_double();
+        if (std::fabs(offset_x) <= 1.0 && std::fabs(offset_y) <= 1.0 / params.aspectRatio) {
+            return false;
+        }
+    }
+
+    BigFixed c_x = params.center_x;
+    BigFixed c_y = params.center_y;
+    c_x.set_fraction_limbs(fraction_limbs);
+    c_y.set_fraction_limbs(fraction_limbs);
+    reference = find_reference_orbit(c_x, c_y, params.max_iterations);
+    return true;
+}
+
+ReferenceOrbit CpuRenderer::find_reference_orbit(const BigFixed& c_x, const BigFixed& c_y, int max_iterations) {
+    if (orbit_cache != nullptr) {
+        return orbit_cache->get(c_x, c_y, max_iterations);
+    }
+    return compute_reference_orbit(c_x, c_y, max_iterations);
+}
+
+bool CpuRenderer::render_frame(const RenderParams& params, std::vector<uint8_t>& rgba,
+                               const CancellationToken& cancel) {
+    std::vector<uint32_t> iterations;
+    if (!render_iterations(params, iterations, cancel)) {
+        return false;
+    }
+    rgba.resize(iterations.size() * 4);
+    colorize(iterations.data(), iterations.size(), params.max_iterations, rgba.data());
+    return true;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "big_fixed.h"
+#include "cancellation.h"
+#include "cpu_features.h"
+#include "escape_kernels.h"
+#include "float_exp.h"
+#include "orbit_cache.h"
+#include "perturbation.h"
+#include "thread_pool.h"
+#include "tile.h"
+#include "tile_scheduler.h"
+
+// Past doubles without perturbation: every pixel is iterated in full double-double (about 106 bits), quad-double
+// (about 212 bits) or 128-bit fixed-point (124 bits) arithmetic. Fixed point gives the same image on every build.
+enum class ExtendedPrecision { None, DoubleDouble, QuadDouble, Fixed128 };
+
+// The values the explorer hands its fragment shaders, plus the frame size.
+struct RenderParams {
+    int width = 1200;
+    int height = 800;
+    // Only perturbation frames go past the range of a double
+    FloatExp zoom = 0.5;
+    double pan_x = 0.0;
+    double pan_y = 0.0;
+    float aspectRatio = 1.5f;
+    int max_iterations = 300;
+    // false mirrors shaders/fragmentShader.glsl, true mirrors shaders/fragmentShader_doubles.glsl
+    bool use_double_precision = false;
+    // Deep zoom: pixels are iterated as double offsets from a reference orbit near (center_x, center_y), which is
+    // computed in full precision. pan_x, pan_y and use_double_precision are ignored.
+    bool use_perturbation = false;
+    BigFixed center_x;
+    BigFixed center_y;
+    // Iterates every pixel around (center_x, center_y) in the given precision. pan_x, pan_y and use_double_precision
+    // are ignored, use_perturbation takes precedence.
+    ExtendedPrecision extended_precision = ExtendedPrecision::None;
+};
+
+// Escape-time renderer that runs the fragment shader's computation on the CPU.
+// Uses the same arithmetic in the same order as the GLSL, so a frame matches what an IEEE-754
+// conforming GPU would produce. Needs no GL context.
+class CpuRenderer {
+   public:
+    static constexpr int tile_size = 64;
+    // Secondary references a perturbation frame may add to resolve its glitches
+    static constexpr int max_references = 128;
+    // Spacing of the first pass of render_progressive(), a preview at 1/8 resolution
+    static constexpr int progressive_spacing = 8;
+
+    // thread_count == 0 uses one thread per hardware thread
+    explicit CpuRenderer(unsigned thread_count = 0);
+
+    unsigned thread_count() const { return pool.size(); }
+
+    // Defaults to detect_simd_level(), lower it to compare kernels
+    void set_simd_level(SimdLevel level) { kernels = &get_escape_kernels(level); }
+    SimdLevel simd_level() const { return kernels->level; }
+
+    // Lane refill keeps every SIMD lane busy on views that mix fast and slow pixels, off by default because
+    // gathering new points costs about as much as the idle lanes save (see --bench refill)
+    void set_lane_refill(bool enabled) { lane_refill = enabled; }
+    bool uses_lane_refill() const { return lane_refill; }
+
+    // Bilinear approximation lets perturbation frames skip the iterations a pixel shares with its reference,
+    // on by default
+    void set_bilinear_approximation(bool enabled) { bilinear_approximation = enabled; }
+    bool uses_bilinear_approximation() const { return bilinear_approximation; }
+
+    // Reprojection reuses the last complete frame when the next one only pans it by whole pixels: its iterations are
+    // shifted along and only the strips that came into view are rendered. A shifted pixel can differ from a fresh
+    // render where rounding its coordinates tips the result, so it is off by default and meant for interactive use.
+    void set_reprojection(bool enabled) { reprojection = enabled; }
+
+    // Pixels the last frame had to render, all of them unless reprojection reused part of the one before
+    long long computed_pixels() const { return last_computed_pixels; }
+
+    // Reference orbits come from cache when one is set and are computed every time otherwise, the default.
+    // The cache must outlive the renderer.
+    void set_orbit_cache(OrbitCache* cache) { orbit_cache = cache; }
+
+    // Per thread tile, steal and split counts of the last frame
+    const std::vector<WorkerStats>& worker_stats() const { return scheduler.stats(); }
+
+    // Computes the reference orbit for a perturbation frame of params, unless the current one still suits the view
+    // so panning does not recompute it. Returns true if the orbit changed.
+    bool update_reference_orbit(const RenderParams& params);
+
+    // Primary reference orbit of the last perturbation frame
+    const ReferenceOrbit& reference_orbit() const { return reference; }
+
+    // References and re-render passes the last perturbation frame needed
+    const PerturbationStats& perturbation_stats() const { return perturbation; }
+
+    // Writes the iteration count of every pixel, max_iterations for pixels that never escaped. Returns false when
+    // cancel was cancelled first, leaving the unfinished pixels undefined. The rows that were done are kept, and the
+    // next call for the same params only renders the rest.
+    bool render_iterations(const RenderParams& params, std::vector<uint32_t>& iterations,
+                           const CancellationToken& cancel = CancellationToken());
+
+    // Renders the frame as RGBA8, 4 bytes per pixel, rows from top to bottom. Returns false, with rgba untouched,
+    // when cancelled.
+    bool render_frame(const RenderParams& params, std::vector<uint8_t>& rgba,
+                      const CancellationToken& cancel = CancellationToken());
+
+    // Gets the whole frame as RGBA8 after every pass of render_progressive(), and the spacing of that pass
+    using PresentFunction = std::function<void(const std::vector<uint8_t>& rgba, int spacing)>;
+
+    // Renders the frame in passes at 1/8, 1/4, 1/2 and full resolution and presents each as soon as it is done, every
+    // iterated pixel standing for the block up to the next one until the last pass. A pass only iterates the pixels
+    // the passes before did not, so all of them cost about as much as render_frame(), and the last presents the same
+    // image. Perturbation frames resolve their glitches in the last pass. Returns false when cancelled.
+    bool render_progressive(const RenderParams& params, const PresentFunction& present,
+                            const CancellationToken& cancel = CancellationToken());
+
+   private:
+    // What a cancelled frame had finished
+    struct PartialFrame {
+        bool valid = false;
+        RenderParams params;
+        std::vector<uint32_t> iterations;
+        // What is left to render after reprojection, the whole frame's tiles otherwise
+        std::vector<Tile> regions;
+        // Spacing the first pass was asked for, the first pass really had, 1 after reprojection, and the pass in
+        // progress. All 1 unless progressive.
+        int first_spacing = 1;
+        int start_spacing = 1;
+        int spacing = 1;
+        // One flag per pixel row of every tile column, set once the pass in progress has iterated the row
+        std::vector<uint8_t> rows_done;
+        // All passes are done, perturbation frames only have glitches left to resolve
+        bool passes_done = false;
+        std::vector<uint8_t> glitched;
+    };
+
+    // Last complete frame, for reprojection
+    struct CompleteFrame {
+        bool valid = false;
+        RenderParams params;
+        std::vector<uint32_t> iterations;
+    };
+
+    // Sets regions to what is left to render of the frame of params, its tiles unless the last complete frame only
+    // differs by a pan of whole pixels. Then, with reprojection on, its iterations are shifted into iterations, just
+    // the strips that came into view are left, and it returns true.
+    bool reproject(const RenderParams& params, std::vector<uint32_t>& iterations, std::vector<Tile>& regions);
+
+    // Passes from first_spacing down to 1, calling pass_done with the spacing of each finished one, if set.
+    // Continues the partial frame when it has the same params and first_spacing.
+    bool render_passes(const RenderParams& params, int first_spacing, std::vector<uint32_t>& iterations,
+                       const CancellationToken& cancel, const std::function<void(int)>& pass_done);
+
+    // Runs render_rows on each tile, a few rows at a time when cancel can be cancelled, and stops once it is. Marks
+    // the rows it finished in partial.rows_done when track_rows is set. Returns false if it stopped early.
+    bool run_tiles(const std::vector<Tile>& tiles, const CancellationToken& cancel, bool track_rows,
+                   const std::function<uint64_t(const Tile&)>& render_rows);
+
+    // One pass over the grid with orbit as the reference, flagging glitches in partial.glitched
+    bool render_perturbation_pass(const RenderParams& params, const ReferenceOrbit& orbit, const BlaTable* bla,
+                                  const std::vector<Tile>& tiles, const PassGrid& grid, bool only_glitched,
+                                  std::vector<uint32_t>& iterations, const CancellationToken& cancel);
+
+    // Re-renders the glitched pixels with a new reference inside the largest glitch until none are left
+    bool resolve_glitches(const RenderParams& params, const std::vector<Tile>& tiles,
+                          std::vector<uint32_t>& iterations, const CancellationToken& cancel);
+
+    // From the orbit cache when there is one
+    ReferenceOrbit find_reference_orbit(const BigFixed& c_x, const BigFixed& c_y, int max_iterations);
+
+    ThreadPool pool;
+    TileScheduler scheduler;
+    const EscapeKernels* kernels;
+    bool lane_refill = false;
+    bool bilinear_approximation = true;
+    OrbitCache* orbit_cache = nullptr;
+    bool reprojection = false;
+    long long last_computed_pixels = 0;
+    ReferenceOrbit reference;
+    PerturbationStats perturbation;
+    PartialFrame partial;
+    CompleteFrame previous;
+};
+
+// Splits a width x height frame into tiles of at most tile_size x tile_size pixels.
+std::vector<Tile> split_into_tiles(int width, int height, int tile_size);
+
+// Whole pixels (dx, dy) the view of b is panned from that of a, so that pixel (x, y) of b is pixel (x + dx, y + dy) of
+// a. False unless that is all that changed and some pixels are left to share.
+bool pixel_shift(const RenderParams& a, const RenderParams& b, int& dx, int& dy);
+
+// Iterates the pixels of one tile the grid takes with the given kernels, writing into the full-frame iterations
+// buffer. With lane_refill the whole tile is one queue of points for the refill kernel, otherwise every row is
+// iterated in fixed groups of lanes. The extended precisions have no refill kernel.
+void render_tile(const RenderParams& params, const EscapeKernels& kernels, bool lane_refill, const Tile& tile,
+                 uint32_t* iterations, const PassGrid& grid = PassGrid());
+
+// Maps iteration counts to RGBA8 exactly like the end of the fragment shader.
+void colorize(const uint32_t* iterations, size_t pixel_count, int max_iterations, uint8_t* rgba);
+
+// Colors like colorize(), but only reads the pixels whose x and y are multiples of spacing, each of which colors the
+// spacing x spacing block to its lower right. Spacing 1 is colorize() of a width x height frame.
+void colorize_samples(const uint32_t* iterations, int width, int height, int spacing, int max_iterations,
+                      uint8_t* rgba);
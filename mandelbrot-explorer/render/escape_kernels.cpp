@@ -0,0 +1,134 @@
+#include "escape_kernels.h"
+
+namespace {
+
+template <typename T>
+uint32_t iterate(T cx, T cy, int max_iterations) {
+    T zx = cx;
+    T zy = cy;
+
+    int i;
+    for (i = 0; i < max_iterations; i++) {
+        T xtemp = zx * zx - zy * zy + cx;
+        zy = T(2.0) * zx * zy + cy;
+        zx = xtemp;
+
+        if (zx * zx + zy * zy > T(4.0)) break;
+    }
+    return static_cast<uint32_t>(i);
+}
+
+// The same iteration in the order the SIMD kernels use. The escape test only looks at the leading terms.
+template <int N>
+uint32_t iterate_multi_double(const MultiDouble<N>& cx, const MultiDouble<N>& cy, int max_iterations) {
+    MultiDouble<N> zx = cx;
+    MultiDouble<N> zy = cy;
+
+    int i;
+    for (i = 0; i < max_iterations; i++) {
+        MultiDouble<N> xtemp = zx * zx - zy * zy + cx;
+        zy = times_two(zx * zy) + cy;
+        zx = xtemp;
+
+        if (zx.x[0] * zx.x[0] + zy.x[0] * zy.x[0] > 4.0) break;
+    }
+    return static_cast<uint32_t>(i);
+}
+
+// Pixels with |c| > 2 escape on the first step. For all others the test that ends a step keeps |zx| and |zy| below 2,
+// so the next step stays below 6 in magnitude and within the range of Fixed128. The squares of one step are reused
+// by the next, which adds no rounding since every product is truncated the same way.
+uint32_t iterate_fixed128(const Fixed128& cx, const Fixed128& cy, int max_iterations) {
+    const Fixed128 two = Fixed128::from_int(2);
+    const Fixed128 four = Fixed128::from_int(4);
+    if (abs(cx) > two || abs(cy) > two) return 0;
+    Fixed128 x2 = square(cx);
+    Fixed128 y2 = square(cy);
+    if (x2 > four - y2) return 0;
+
+    Fixed128 zx = cx;
+    Fixed128 zy = cy;
+    int i;
+    for (i = 0; i < max_iterations; i++) {
+        Fixed128 product = zx * zy;
+        zx = x2 - y2 + cx;
+        zy = times_two(product) + cy;
+
+        if (abs(zx) > two || abs(zy) > two) break;
+        x2 = square(zx);
+        y2 = square(zy);
+        if (x2 > four - y2) break;
+    }
+    return static_cast<uint32_t>(i);
+}
+
+// SSE2 has no fma and only two doubles per vector, its multi-double kernels are the scalar ones
+const EscapeKernels kernel_table[] = {
+    {SimdLevel::Scalar, 1, 1, escape_float_scalar, escape_double_scalar, refill_float_scalar, refill_double_scalar,
+     escape_double_double_scalar, escape_quad_double_scalar},
+#if ESCAPE_KERNELS_X86
+    {SimdLevel::SSE2, 4, 2, escape_float_sse2, escape_double_sse2, refill_float_sse2, refill_double_sse2,
+     escape_double_double_scalar, escape_quad_double_scalar},
+    {SimdLevel::AVX2, 8, 4, escape_float_avx2, escape_double_avx2, refill_float_avx2, refill_double_avx2,
+     escape_double_double_avx2, escape_quad_double_avx2},
+    {SimdLevel::AVX512, 16, 8, escape_float_avx512, escape_double_avx512, refill_float_avx512,
+     refill_double_avx512, escape_double_double_avx2, escape_quad_double_avx2},
+#endif
+};
+
+}  // namespace
+
+void escape_float_scalar(const float* cx, float cy, int count, int max_iterations, uint32_t* out) {
+    for (int k = 0; k < count; k++) {
+        out[k] = iterate<float>(cx[k], cy, max_iterations);
+    }
+}
+
+void escape_double_scalar(const double* cx, double cy, int count, int max_iterations, uint32_t* out) {
+    for (int k = 0; k < count; k++) {
+        out[k] = iterate<double>(cx[k], cy, max_iterations);
+    }
+}
+
+// A single lane never waits for another one, so the scalar refill kernel is the plain loop
+void refill_float_scalar(const float* cx, const float* cy, int count, int max_iterations, uint32_t* out) {
+    for (int k = 0; k < count; k++) {
+        out[k] = iterate<float>(cx[k], cy[k], max_iterations);
+    }
+}
+
+void refill_double_scalar(const double* cx, const double* cy, int count, int max_iterations, uint32_t* out) {
+    for (int k = 0; k < count; k++) {
+        out[k] = iterate<double>(cx[k], cy[k], max_iterations);
+    }
+}
+
+const EscapeKernels& get_escape_kernels(SimdLevel level) {
+    const EscapeKernels* best = &kernel_table[0];
+    for (const EscapeKernels& kernels : kernel_table) {
+        if (kernels.level <= level) {
+            best = &kernels;
+        }
+    }
+    return *best;
+}
+
+void escape_double_double_scalar(const DoubleDouble* cx, const DoubleDouble& cy, int count, int max_iterations,
+                                 uint32_t* out) {
+    for (int k = 0; k < count; k++) {
+        out[k] = iterate_multi_double<2>(cx[k], cy, max_iterations);
+    }
+}
+
+void escape_quad_double_scalar(const QuadDouble* cx, const QuadDouble& cy, int count, int max_iterations,
+                               uint32_t* out) {
+    for (int k = 0; k < count; k++) {
+        out[k] = iterate_multi_double<4>(cx[k], cy, max_iterations);
+    }
+}
+
+void escape_fixed128(const Fixed128* cx, const Fixed128& cy, int count, int max_iterations, uint32_t* out) {
+    for (int k = 0; k < count; k++) {
+        out[k] = iterate_fixed128(cx[k], cy, max_iterations);
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+
+#include "cpu_features.h"
+#include "fixed128.h"
+#include "multi_double.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ESCAPE_KERNELS_X86 1
+#endif
+
+// GCC and Clang only accept intrinsics for instruction sets enabled on the function, MSVC accepts them anywhere.
+// GCC fuses the multiplies and adds of intrinsics once the target has FMA, which "avx512f" implies, unless
+// fp-contract is off. Clang and MSVC never fuse separate intrinsics.
+#if defined(__GNUC__) && !defined(__clang__)
+#define KERNEL_TARGET(isa) __attribute__((target(isa), optimize("fp-contract=off")))
+#elif defined(__GNUC__)
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define KERNEL_TARGET(isa)
+#endif
+
+// Iterates z = z^2 + c for the points c = (cx[k], cy), k in [0, count), and writes the iteration at which each
+// point escaped, or max_iterations, to out[k]. Every kernel does the same IEEE operations in the same order as the
+// loop in the fragment shaders, so all of them produce identical output.
+using EscapeKernelFloat = void (*)(const float* cx, float cy, int count, int max_iterations, uint32_t* out);
+using EscapeKernelDouble = void (*)(const double* cx, double cy, int count, int max_iterations, uint32_t* out);
+
+// Same result for the points c = (cx[k], cy[k]), but a lane whose point escaped writes out[k] and takes the next
+// pending point right away instead of idling until the slowest lane of its vector is done.
+using RefillKernelFloat = void (*)(const float* cx, const float* cy, int count, int max_iterations, uint32_t* out);
+using RefillKernelDouble = void (*)(const double* cx, const double* cy, int count, int max_iterations,
+                                    uint32_t* out);
+
+// Same for double-double and quad-double points, past the precision of doubles. These have no shader counterpart,
+// but the scalar and SIMD kernels agree with each other.
+using EscapeKernelDoubleDouble = void (*)(const DoubleDouble* cx, const DoubleDouble& cy, int count,
+                                          int max_iterations, uint32_t* out);
+using EscapeKernelQuadDouble = void (*)(const QuadDouble* cx, const QuadDouble& cy, int count, int max_iterations,
+                                        uint32_t* out);
+
+struct EscapeKernels {
+    SimdLevel level;
+    int float_lanes;
+    int double_lanes;
+    EscapeKernelFloat iterate_float;
+    EscapeKernelDouble iterate_double;
+    RefillKernelFloat refill_float;
+    RefillKernelDouble refill_double;
+    EscapeKernelDoubleDouble iterate_double_double;
+    EscapeKernelQuadDouble iterate_quad_double;
+};
+
+// Kernels for level, or for the widest level below it that this build has.
+const EscapeKernels& get_escape_kernels(SimdLevel level);
+
+void escape_float_scalar(const float* cx, float cy, int count, int max_iterations, uint32_t* out);
+void escape_double_scalar(const double* cx, double cy, int count, int max_iterations, uint32_t* out);
+void refill_float_scalar(const float* cx, const float* cy, int count, int max_iterations, uint32_t* out);
+void refill_double_scalar(const double* cx, const double* cy, int count, int max_iterations, uint32_t* out);
+void escape_double_double_scalar(const DoubleDouble* cx, const DoubleDouble& cy, int count, int max_iterations,
+                                 uint32_t* out);
+void escape_quad_double_scalar(const QuadDouble* cx, const QuadDouble& cy, int count, int max_iterations,
+                               uint32_t* out);
+
+// Same in fixed point. Integer results do not depend on compiler flags, so this gives the same image on every build.
+// It has no SIMD version, vector units have no 64x64-bit multiply with a 128-bit product.
+void escape_fixed128(const Fixed128* cx, const Fixed128& cy, int count, int max_iterations, uint32_t* out);
+
+#if ESCAPE_KERNELS_X86
+void escape_float_sse2(const float* cx, float cy, int count, int max_iterations, uint32_t* out);
+void escape_double_sse2(const double* cx, double cy, int count, int max_iterations, uint32_t* out);
+void refill_float_sse2(const float* cx, const float* cy, int count, int max_iterations, uint32_t* out);
+void refill_double_sse2(const double* cx, const double* cy, int count, int max_iterations, uint32_t* out);
+void escape_float_avx2(const float* cx, float cy, int count, int max_iterations, uint32_t* out);
+void escape_double_avx2(const double* cx, double cy, int count, int max_iterations, uint32_t* out);
+void refill_float_avx2(const float* cx, const float* cy, int count, int max_iterations, uint32_t* out);
+void refill_double_avx2(const double* cx, const double* cy, int count, int max_iterations, uint32_t* out);
+void escape_float_avx512(const float* cx, float cy, int count, int max_iterations, uint32_t* out);
+void escape_double_avx512(const double* cx, double cy, int count, int max_iterations, uint32_t* out);
+void refill_float_avx512(const float* cx, const float* cy, int count, int max_iterations, uint32_t* out);
+void refill_double_avx512(const double* cx, const double* cy, int count, int max_iterations, uint32_t* out);
+// These use fma for their exact products, detect_simd_level() only reports AVX2 along with fma
+void escape_double_double_avx2(const DoubleDouble* cx, const DoubleDouble& cy, int count, int max_iterations,
+                               uint32_t* out);
+void escape_quad_double_avx2(const QuadDouble* cx, const QuadDouble& cy, int count, int max_iterations,
+                             uint32_t* out);
+#endif
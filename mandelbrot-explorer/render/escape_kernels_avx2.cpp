@@ -0,0 +1,271 @@
+#include "escape_kernels.h"
+
+#if ESCAPE_KERNELS_X86
+
+#include <immintrin.h>
+
+// Only "avx2" is enabled, not "fma", so the compiler cannot fuse the multiplies and adds below
+
+namespace {
+
+// One vector of lanes working through the shared point queue. Two of them are iterated side by side so one
+// hides the latency of the other's dependency chain.
+struct FloatLanes {
+    __m256 cx, cy, zx, zy;
+    __m256i n;
+    __m256 active;
+    int point[8];
+};
+
+KERNEL_TARGET("avx2")
+inline int step_lanes(FloatLanes& lanes, __m256i max_v) {
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 four = _mm256_set1_ps(4.0f);
+    __m256 zx = lanes.zx;
+    __m256 zy = lanes.zy;
+
+    __m256 xtemp = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(zx, zx), _mm256_mul_ps(zy, zy)), lanes.cx);
+    zy = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(two, zx), zy), lanes.cy);
+    zx = xtemp;
+    lanes.zx = zx;
+    lanes.zy = zy;
+
+    __m256 magnitude = _mm256_add_ps(_mm256_mul_ps(zx, zx), _mm256_mul_ps(zy, zy));
+    __m256 escaped = _mm256_and_ps(_mm256_cmp_ps(magnitude, four, _CMP_GT_OQ), lanes.active);
+    // Active lanes that did not escape completed one more iteration
+    __m256i continued = _mm256_andnot_si256(_mm256_castps_si256(escaped), _mm256_castps_si256(lanes.active));
+    lanes.n = _mm256_sub_epi32(lanes.n, continued);
+    __m256 at_limit = _mm256_castsi256_ps(_mm256_cmpeq_epi32(lanes.n, max_v));
+    return _mm256_movemask_ps(_mm256_or_ps(escaped, _mm256_and_ps(lanes.active, at_limit)));
+}
+
+// Writes out the results of the done lanes and loads the next pending points into them. The lane state is
+// spilled to memory and patched in scalar code.
+KERNEL_TARGET("avx2")
+void refill_lanes(FloatLanes& lanes, int done_lanes, const float* cx, const float* cy, int count, int& next,
+                  uint32_t* out) {
+    alignas(32) float lane_cx[8], lane_cy[8], lane_zx[8], lane_zy[8];
+    alignas(32) int32_t lane_n[8];
+    alignas(32) int32_t lane_active[8];
+    _mm256_store_ps(lane_cx, lanes.cx);
+    _mm256_store_ps(lane_cy, lanes.cy);
+    _mm256_store_ps(lane_zx, lanes.zx);
+    _mm256_store_ps(lane_zy, lanes.zy);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lane_n), lanes.n);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lane_active), _mm256_castps_si256(lanes.active));
+
+    for (int l = 0; l < 8; l++) {
+        if ((done_lanes & (1 << l)) == 0) continue;
+        if (lanes.point[l] >= 0) out[lanes.point[l]] = static_cast<uint32_t>(lane_n[l]);
+        if (next < count) {
+            lanes.point[l] = next;
+            lane_cx[l] = lane_zx[l] = cx[next];
+            lane_cy[l] = lane_zy[l] = cy[next];
+            lane_n[l] = 0;
+            lane_active[l] = -1;
+            next++;
+        } else {
+            lanes.point[l] = -1;
+            lane_active[l] = 0;
+        }
+    }
+
+    lanes.cx = _mm256_load_ps(lane_cx);
+    lanes.cy = _mm256_load_ps(lane_cy);
+    lanes.zx = _mm256_load_ps(lane_zx);
+    lanes.zy = _mm256_load_ps(lane_zy);
+    lanes.n = _mm256_load_si256(reinterpret_cast<const __m256i*>(lane_n));
+    lanes.active = _mm256_castsi256_ps(_mm256_load_si256(reinterpret_cast<const __m256i*>(lane_active)));
+}
+
+// FloatLanes for doubles
+struct DoubleLanes {
+    __m256d cx, cy, zx, zy;
+    __m256d n;
+    __m256d active;
+    int point[4];
+};
+
+KERNEL_TARGET("avx2")
+inline int step_lanes(DoubleLanes& lanes, __m256d max_v) {
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d four = _mm256_set1_pd(4.0);
+    __m256d zx = lanes.zx;
+    __m256d zy = lanes.zy;
+
+    __m256d xtemp = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(zx, zx), _mm256_mul_pd(zy, zy)), lanes.cx);
+    zy = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(two, zx), zy), lanes.cy);
+    zx = xtemp;
+    lanes.zx = zx;
+    lanes.zy = zy;
+
+    __m256d magnitude = _mm256_add_pd(_mm256_mul_pd(zx, zx), _mm256_mul_pd(zy, zy));
+    __m256d escaped = _mm256_and_pd(_mm256_cmp_pd(magnitude, four, _CMP_GT_OQ), lanes.active);
+    // Active lanes that did not escape completed one more iteration, counts are exact in a double
+    lanes.n = _mm256_add_pd(lanes.n, _mm256_and_pd(_mm256_andnot_pd(escaped, lanes.active), _mm256_set1_pd(1.0)));
+    __m256d at_limit = _mm256_cmp_pd(lanes.n, max_v, _CMP_EQ_OQ);
+    return _mm256_movemask_pd(_mm256_or_pd(escaped, _mm256_and_pd(lanes.active, at_limit)));
+}
+
+// Writes out the results of the done lanes and loads the next pending points into them. The lane state is
+// spilled to memory and patched in scalar code.
+KERNEL_TARGET("avx2")
+void refill_lanes(DoubleLanes& lanes, int done_lanes, const double* cx, const double* cy, int count, int& next,
+                  uint32_t* out) {
+    alignas(32) double lane_cx[4], lane_cy[4], lane_zx[4], lane_zy[4];
+    alignas(32) double lane_n[4];
+    alignas(32) int64_t lane_active[4];
+    _mm256_store_pd(lane_cx, lanes.cx);
+    _mm256_store_pd(lane_cy, lanes.cy);
+    _mm256_store_pd(lane_zx, lanes.zx);
+    _mm256_store_pd(lane_zy, lanes.zy);
+    _mm256_store_pd(lane_n, lanes.n);
+    _mm256_store_pd(reinterpret_cast<double*>(lane_active), lanes.active);
+
+    for (int l = 0; l < 4; l++) {
+        if ((done_lanes & (1 << l)) == 0) continue;
+        if (lanes.point[l] >= 0) out[lanes.point[l]] = static_cast<uint32_t>(lane_n[l]);
+        if (next < count) {
+            lanes.point[l] = next;
+            lane_cx[l] = lane_zx[l] = cx[next];
+            lane_cy[l] = lane_zy[l] = cy[next];
+            lane_n[l] = 0.0;
+            lane_active[l] = -1;
+            next++;
+        } else {
+            lanes.point[l] = -1;
+            lane_active[l] = 0;
+        }
+    }
+
+    lanes.cx = _mm256_load_pd(lane_cx);
+    lanes.cy = _mm256_load_pd(lane_cy);
+    lanes.zx = _mm256_load_pd(lane_zx);
+    lanes.zy = _mm256_load_pd(lane_zy);
+    lanes.n = _mm256_load_pd(lane_n);
+    lanes.active = _mm256_load_pd(reinterpret_cast<const double*>(lane_active));
+}
+
+}  // namespace
+
+KERNEL_TARGET("avx2")
+void escape_float_avx2(const float* cx, float cy, int count, int max_iterations, uint32_t* out) {
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 four = _mm256_set1_ps(4.0f);
+    const __m256 cy_v = _mm256_set1_ps(cy);
+    const __m256i lane_index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    for (int base = 0; base < count; base += 8) {
+        // Lanes past the end of the span start out inactive and are never loaded or stored
+        __m256i tail = _mm256_cmpgt_epi32(_mm256_set1_epi32(count - base), lane_index);
+        __m256 cx_v = _mm256_maskload_ps(cx + base, tail);
+        __m256 zx = cx_v;
+        __m256 zy = cy_v;
+        __m256i iterations = _mm256_set1_epi32(max_iterations);
+        __m256 active = _mm256_castsi256_ps(tail);
+
+        for (int i = 0; i < max_iterations; i++) {
+            __m256 xtemp = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(zx, zx), _mm256_mul_ps(zy, zy)), cx_v);
+            zy = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(two, zx), zy), cy_v);
+            zx = xtemp;
+
+            __m256 magnitude = _mm256_add_ps(_mm256_mul_ps(zx, zx), _mm256_mul_ps(zy, zy));
+            __m256 escaped = _mm256_and_ps(_mm256_cmp_ps(magnitude, four, _CMP_GT_OQ), active);
+            iterations = _mm256_blendv_epi8(iterations, _mm256_set1_epi32(i), _mm256_castps_si256(escaped));
+            active = _mm256_andnot_ps(escaped, active);
+            if (_mm256_testz_ps(active, active)) break;
+        }
+
+        _mm256_maskstore_epi32(reinterpret_cast<int*>(out + base), tail, iterations);
+    }
+}
+
+KERNEL_TARGET("avx2")
+void escape_double_avx2(const double* cx, double cy, int count, int max_iterations, uint32_t* out) {
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d cy_v = _mm256_set1_pd(cy);
+    const __m256i lane_index = _mm256_setr_epi64x(0, 1, 2, 3);
+
+    for (int base = 0; base < count; base += 4) {
+        __m256i tail = _mm256_cmpgt_epi64(_mm256_set1_epi64x(count - base), lane_index);
+        __m256d cx_v = _mm256_maskload_pd(cx + base, tail);
+        __m256d zx = cx_v;
+        __m256d zy = cy_v;
+        // Iteration counts are exact in a double, which saves converting masks between element widths
+        __m256d iterations = _mm256_set1_pd(max_iterations);
+        __m256d active = _mm256_castsi256_pd(tail);
+
+        for (int i = 0; i < max_iterations; i++) {
+            __m256d xtemp = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(zx, zx), _mm256_mul_pd(zy, zy)), cx_v);
+            zy = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(two, zx), zy), cy_v);
+            zx = xtemp;
+
+            __m256d magnitude = _mm256_add_pd(_mm256_mul_pd(zx, zx), _mm256_mul_pd(zy, zy));
+            __m256d escaped = _mm256_and_pd(_mm256_cmp_pd(magnitude, four, _CMP_GT_OQ), active);
+            iterations = _mm256_blendv_pd(iterations, _mm256_set1_pd(i), escaped);
+            active = _mm256_andnot_pd(escaped, active);
+            if (_mm256_testz_pd(active, active)) break;
+        }
+
+        alignas(16) int32_t lane_out[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lane_out), _mm256_cvtpd_epi32(iterations));
+        for (int k = 0; k < 4 && base + k < count; k++) {
+            out[base + k] = static_cast<uint32_t>(lane_out[k]);
+        }
+    }
+}
+
+KERNEL_TARGET("avx2")
+void refill_float_avx2(const float* cx, const float* cy, int count, int max_iterations, uint32_t* out) {
+    if (max_iterations <= 0) {
+        for (int k = 0; k < count; k++) out[k] = 0;
+        return;
+    }
+    const __m256i max_v = _mm256_set1_epi32(max_iterations);
+    const int all_lanes = (1 << 8) - 1;
+
+    FloatLanes a;
+    a.cx = a.cy = a.zx = a.zy = a.active = _mm256_setzero_ps();
+    a.n = _mm256_setzero_si256();
+    for (int l = 0; l < 8; l++) a.point[l] = -1;
+    FloatLanes b = a;
+    int next = 0;
+    refill_lanes(a, all_lanes, cx, cy, count, next, out);
+    refill_lanes(b, all_lanes, cx, cy, count, next, out);
+
+    while ((_mm256_movemask_ps(a.active) | _mm256_movemask_ps(b.active)) != 0) {
+        int done_a = step_lanes(a, max_v);
+        int done_b = step_lanes(b, max_v);
+        if (done_a != 0) refill_lanes(a, done_a, cx, cy, count, next, out);
+        if (done_b != 0) refill_lanes(b, done_b, cx, cy, count, next, out);
+    }
+}
+
+KERNEL_TARGET("avx2")
+void refill_double_avx2(const double* cx, const double* cy, int count, int max_iterations, uint32_t* out) {
+    if (max_iterations <= 0) {
+        for (int k = 0; k < count; k++) out[k] = 0;
+        return;
+    }
+    const __m256d max_v = _mm256_set1_pd(max_iterations);
+    const int all_lanes = (1 << 4) - 1;
+
+    DoubleLanes a;
+    a.cx = a.cy = a.zx = a.zy = a.active = _mm256_setzero_pd();
+    a.n = _mm256_setzero_pd();
+    for (int l = 0; l < 4; l++) a.point[l] = -1;
+    DoubleLanes b = a;
+    int next = 0;
+    refill_lanes(a, all_lanes, cx, cy, count, next, out);
+    refill_lanes(b, all_lanes, cx, cy, count, next, out);
+
+    while ((_mm256_movemask_pd(a.active) | _mm256_movemask_pd(b.active)) != 0) {
+        int done_a = step_lanes(a, max_v);
+        int done_b = step_lanes(b, max_v);
+        if (done_a != 0) refill_lanes(a, done_a, cx, cy, count, next, out);
+        if (done_b != 0) refill_lanes(b, done_b, cx, cy, count, next, out);
+    }
+}
+
+#endif
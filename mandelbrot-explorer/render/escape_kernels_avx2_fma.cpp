@@ -0,0 +1,223 @@
+#include "escape_kernels.h"
+
+#if ESCAPE_KERNELS_X86
+
+#include <immintrin.h>
+
+// The operations of multi_double.h on four lanes. fma only stands in for Dekker's product, where it gives the same
+// exact error term, every other multiply and add stays separate so the lanes match the scalar kernels.
+
+namespace {
+
+template <int N>
+struct MultiDoubleLanes {
+    __m256d x[N];
+};
+
+KERNEL_TARGET("avx2,fma")
+inline __m256d two_sum(__m256d a, __m256d b, __m256d& e) {
+    __m256d s = _mm256_add_pd(a, b);
+    __m256d v = _mm256_sub_pd(s, a);
+    e = _mm256_add_pd(_mm256_sub_pd(a, _mm256_sub_pd(s, v)), _mm256_sub_pd(b, v));
+    return s;
+}
+
+KERNEL_TARGET("avx2,fma")
+inline __m256d quick_two_sum(__m256d a, __m256d b, __m256d& e) {
+    __m256d s = _mm256_add_pd(a, b);
+    e = _mm256_sub_pd(b, _mm256_sub_pd(s, a));
+    return s;
+}
+
+KERNEL_TARGET("avx2,fma")
+inline __m256d two_product(__m256d a, __m256d b, __m256d& e) {
+    __m256d p = _mm256_mul_pd(a, b);
+    e = _mm256_fmsub_pd(a, b, p);
+    return p;
+}
+
+KERNEL_TARGET("avx2,fma")
+inline MultiDoubleLanes<2> add(const MultiDoubleLanes<2>& a, const MultiDoubleLanes<2>& b) {
+    __m256d e1;
+    __m256d e2;
+    __m256d s1 = two_sum(a.x[0], b.x[0], e1);
+    __m256d s2 = two_sum(a.x[1], b.x[1], e2);
+    e1 = _mm256_add_pd(e1, s2);
+    s1 = quick_two_sum(s1, e1, e1);
+    e1 = _mm256_add_pd(e1, e2);
+    s1 = quick_two_sum(s1, e1, e1);
+    return {{s1, e1}};
+}
+
+KERNEL_TARGET("avx2,fma")
+inline MultiDoubleLanes<2> multiply(const MultiDoubleLanes<2>& a, const MultiDoubleLanes<2>& b) {
+    __m256d e;
+    __m256d p = two_product(a.x[0], b.x[0], e);
+    e = _mm256_add_pd(e, _mm256_add_pd(_mm256_mul_pd(a.x[0], b.x[1]), _mm256_mul_pd(a.x[1], b.x[0])));
+    p = quick_two_sum(p, e, e);
+    return {{p, e}};
+}
+
+KERNEL_TARGET("avx2,fma")
+inline void three_sum(__m256d& a, __m256d& b, __m256d& c) {
+    __m256d t2;
+    __m256d t3;
+    __m256d t1 = two_sum(a, b, t2);
+    a = two_sum(c, t1, t3);
+    b = two_sum(t2, t3, c);
+}
+
+KERNEL_TARGET("avx2,fma")
+inline void three_sum2(__m256d& a, __m256d& b, __m256d c) {
+    __m256d t2;
+    __m256d t3;
+    __m256d t1 = two_sum(a, b, t2);
+    a = two_sum(c, t1, t3);
+    b = _mm256_add_pd(t2, t3);
+}
+
+KERNEL_TARGET("avx2,fma")
+inline MultiDoubleLanes<4> renormalize(__m256d c0, __m256d c1, __m256d c2, __m256d c3, __m256d c4) {
+    __m256d s = quick_two_sum(c3, c4, c4);
+    s = quick_two_sum(c2, s, c3);
+    s = quick_two_sum(c1, s, c2);
+    c0 = quick_two_sum(c0, s, c1);
+    c1 = quick_two_sum(c1, c2, c2);
+    c2 = quick_two_sum(c2, c3, c3);
+    c3 = _mm256_add_pd(c3, c4);
+    return {{c0, c1, c2, c3}};
+}
+
+KERNEL_TARGET("avx2,fma")
+inline MultiDoubleLanes<4> add(const MultiDoubleLanes<4>& a, const MultiDoubleLanes<4>& b) {
+    __m256d t0;
+    __m256d t1;
+    __m256d t2;
+    __m256d t3;
+    __m256d s0 = two_sum(a.x[0], b.x[0], t0);
+    __m256d s1 = two_sum(a.x[1], b.x[1], t1);
+    __m256d s2 = two_sum(a.x[2], b.x[2], t2);
+    __m256d s3 = two_sum(a.x[3], b.x[3], t3);
+    s1 = two_sum(s1, t0, t0);
+    three_sum(s2, t0, t1);
+    three_sum2(s3, t0, t2);
+    t0 = _mm256_add_pd(_mm256_add_pd(t0, t1), t3);
+    return renormalize(s0, s1, s2, s3, t0);
+}
+
+KERNEL_TARGET("avx2,fma")
+inline MultiDoubleLanes<4> multiply(const MultiDoubleLanes<4>& a, const MultiDoubleLanes<4>& b) {
+    __m256d q0;
+    __m256d q1;
+    __m256d q2;
+    __m256d q3;
+    __m256d q4;
+    __m256d q5;
+    __m256d p0 = two_product(a.x[0], b.x[0], q0);
+    __m256d p1 = two_product(a.x[0], b.x[1], q1);
+    __m256d p2 = two_product(a.x[1], b.x[0], q2);
+    __m256d p3 = two_product(a.x[0], b.x[2], q3);
+    __m256d p4 = two_product(a.x[1], b.x[1], q4);
+    __m256d p5 = two_product(a.x[2], b.x[0], q5);
+
+    three_sum(p1, p2, q0);
+    three_sum(p2, q1, q2);
+    three_sum(p3, p4, p5);
+
+    __m256d t0;
+    __m256d t1;
+    __m256d s0 = two_sum(p2, p3, t0);
+    __m256d s1 = two_sum(q1, p4, t1);
+    __m256d s2 = _mm256_add_pd(q2, p5);
+    s1 = two_sum(s1, t0, t0);
+    s2 = _mm256_add_pd(s2, _mm256_add_pd(t0, t1));
+    __m256d rest = _mm256_add_pd(_mm256_mul_pd(a.x[0], b.x[3]), _mm256_mul_pd(a.x[1], b.x[2]));
+    rest = _mm256_add_pd(rest, _mm256_mul_pd(a.x[2], b.x[1]));
+    rest = _mm256_add_pd(rest, _mm256_mul_pd(a.x[3], b.x[0]));
+    rest = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_add_pd(rest, q0), q3), q4), q5);
+    s1 = _mm256_add_pd(s1, rest);
+    return renormalize(p0, p1, s0, s1, s2);
+}
+
+template <int N>
+KERNEL_TARGET("avx2,fma")
+inline MultiDoubleLanes<N> negate(const MultiDoubleLanes<N>& a) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    MultiDoubleLanes<N> result;
+    for (int k = 0; k < N; k++) {
+        result.x[k] = _mm256_xor_pd(a.x[k], sign);
+    }
+    return result;
+}
+
+template <int N>
+KERNEL_TARGET("avx2,fma")
+inline MultiDoubleLanes<N> times_two(const MultiDoubleLanes<N>& a) {
+    const __m256d two = _mm256_set1_pd(2.0);
+    MultiDoubleLanes<N> result;
+    for (int k = 0; k < N; k++) {
+        result.x[k] = _mm256_mul_pd(two, a.x[k]);
+    }
+    return result;
+}
+
+// Four points per vector like escape_double_avx2, the lanes past count repeat the last point and are masked off
+template <int N>
+KERNEL_TARGET("avx2,fma")
+void escape_multi_double(const MultiDouble<N>* cx, const MultiDouble<N>& cy, int count, int max_iterations,
+                         uint32_t* out) {
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256i lane_index = _mm256_setr_epi64x(0, 1, 2, 3);
+    MultiDoubleLanes<N> cy_v;
+    for (int k = 0; k < N; k++) {
+        cy_v.x[k] = _mm256_set1_pd(cy.x[k]);
+    }
+
+    for (int base = 0; base < count; base += 4) {
+        __m256i tail = _mm256_cmpgt_epi64(_mm256_set1_epi64x(count - base), lane_index);
+        const MultiDouble<N>* lanes[4];
+        for (int l = 0; l < 4; l++) {
+            lanes[l] = cx + (base + l < count ? base + l : count - 1);
+        }
+        MultiDoubleLanes<N> cx_v;
+        for (int k = 0; k < N; k++) {
+            cx_v.x[k] = _mm256_setr_pd(lanes[0]->x[k], lanes[1]->x[k], lanes[2]->x[k], lanes[3]->x[k]);
+        }
+        MultiDoubleLanes<N> zx = cx_v;
+        MultiDoubleLanes<N> zy = cy_v;
+        __m256d iterations = _mm256_set1_pd(max_iterations);
+        __m256d active = _mm256_castsi256_pd(tail);
+
+        for (int i = 0; i < max_iterations; i++) {
+            MultiDoubleLanes<N> xtemp = add(add(multiply(zx, zx), negate(multiply(zy, zy))), cx_v);
+            zy = add(times_two(multiply(zx, zy)), cy_v);
+            zx = xtemp;
+
+            __m256d magnitude = _mm256_add_pd(_mm256_mul_pd(zx.x[0], zx.x[0]), _mm256_mul_pd(zy.x[0], zy.x[0]));
+            __m256d escaped = _mm256_and_pd(_mm256_cmp_pd(magnitude, four, _CMP_GT_OQ), active);
+            iterations = _mm256_blendv_pd(iterations, _mm256_set1_pd(i), escaped);
+            active = _mm256_andnot_pd(escaped, active);
+            if (_mm256_testz_pd(active, active)) break;
+        }
+
+        alignas(16) int32_t lane_out[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lane_out), _mm256_cvtpd_epi32(iterations));
+        for (int k = 0; k < 4 && base + k < count; k++) {
+            out[base + k] = static_cast<uint32_t>(lane_out[k]);
+        }
+    }
+}
+
+}  // namespace
+
+void escape_double_double_avx2(const DoubleDouble* cx, const DoubleDouble& cy, int count, int max_iterations,
+                               uint32_t* out) {
+    escape_multi_double<2>(cx, cy, count, max_iterations, out);
+}
+
+void escape_quad_double_avx2(const QuadDouble* cx, const QuadDouble& cy, int count, int max_iterations,
+                             uint32_t* out) {
+    escape_multi_double<4>(cx, cy, count, max_iterations, out);
+}
+
+#endif
@@ -0,0 +1,243 @@
+#include "escape_kernels.h"
+
+#if ESCAPE_KERNELS_X86
+
+#include <immintrin.h>
+
+// Needs AVX-512F only. Escaped and out-of-range lanes are switched off in the opmask registers.
+
+KERNEL_TARGET("avx512f")
+void escape_float_avx512(const float* cx, float cy, int count, int max_iterations, uint32_t* out) {
+    const __m512 two = _mm512_set1_ps(2.0f);
+    const __m512 four = _mm512_set1_ps(4.0f);
+    const __m512 cy_v = _mm512_set1_ps(cy);
+
+    for (int base = 0; base < count; base += 16) {
+        int lanes = count - base < 16 ? count - base : 16;
+        __mmask16 tail = static_cast<__mmask16>((1u << lanes) - 1);
+        __m512 cx_v = _mm512_maskz_loadu_ps(tail, cx + base);
+        __m512 zx = cx_v;
+        __m512 zy = cy_v;
+        __m512i iterations = _mm512_set1_epi32(max_iterations);
+        __mmask16 active = tail;
+
+        for (int i = 0; i < max_iterations; i++) {
+            __m512 xtemp = _mm512_add_ps(_mm512_sub_ps(_mm512_mul_ps(zx, zx), _mm512_mul_ps(zy, zy)), cx_v);
+            zy = _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(two, zx), zy), cy_v);
+            zx = xtemp;
+
+            __m512 magnitude = _mm512_add_ps(_mm512_mul_ps(zx, zx), _mm512_mul_ps(zy, zy));
+            __mmask16 escaped = _mm512_mask_cmp_ps_mask(active, magnitude, four, _CMP_GT_OQ);
+            iterations = _mm512_mask_mov_epi32(iterations, escaped, _mm512_set1_epi32(i));
+            active = static_cast<__mmask16>(active & ~escaped);
+            if (active == 0) break;
+        }
+
+        _mm512_mask_storeu_epi32(out + base, tail, iterations);
+    }
+}
+
+KERNEL_TARGET("avx512f")
+void escape_double_avx512(const double* cx, double cy, int count, int max_iterations, uint32_t* out) {
+    const __m512d two = _mm512_set1_pd(2.0);
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512d cy_v = _mm512_set1_pd(cy);
+
+    for (int base = 0; base < count; base += 8) {
+        int lanes = count - base < 8 ? count - base : 8;
+        __mmask8 tail = static_cast<__mmask8>((1u << lanes) - 1);
+        __m512d cx_v = _mm512_maskz_loadu_pd(tail, cx + base);
+        __m512d zx = cx_v;
+        __m512d zy = cy_v;
+        // 64-bit lanes so the opmask of the comparison applies directly to the counters
+        __m512i iterations = _mm512_set1_epi64(max_iterations);
+        __mmask8 active = tail;
+
+        for (int i = 0; i < max_iterations; i++) {
+            __m512d xtemp = _mm512_add_pd(_mm512_sub_pd(_mm512_mul_pd(zx, zx), _mm512_mul_pd(zy, zy)), cx_v);
+            zy = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(two, zx), zy), cy_v);
+            zx = xtemp;
+
+            __m512d magnitude = _mm512_add_pd(_mm512_mul_pd(zx, zx), _mm512_mul_pd(zy, zy));
+            __mmask8 escaped = _mm512_mask_cmp_pd_mask(active, magnitude, four, _CMP_GT_OQ);
+            iterations = _mm512_mask_mov_epi64(iterations, escaped, _mm512_set1_epi64(i));
+            active = static_cast<__mmask8>(active & ~escaped);
+            if (active == 0) break;
+        }
+
+        _mm512_mask_cvtepi64_storeu_epi32(out + base, tail, iterations);
+    }
+}
+
+namespace {
+
+// Mask with only the lowest `count` set bits of mask left
+unsigned lowest_bits(unsigned mask, int count) {
+    unsigned result = 0;
+    for (int k = 0; k < count && mask != 0; k++) {
+        result |= mask & (0u - mask);
+        mask &= mask - 1;
+    }
+    return result;
+}
+
+int bit_count(unsigned mask) {
+    int count = 0;
+    for (; mask != 0; mask &= mask - 1) count++;
+    return count;
+}
+
+// One vector of lanes working through the shared point queue. Two of them are iterated side by side so one
+// hides the latency of the other's dependency chain.
+struct FloatLanes {
+    __m512 cx, cy, zx, zy;
+    __m512i n, point;
+    __mmask16 active;
+};
+
+KERNEL_TARGET("avx512f")
+inline __mmask16 step_lanes(FloatLanes& lanes, __m512i max_v) {
+    const __m512 two = _mm512_set1_ps(2.0f);
+    const __m512 four = _mm512_set1_ps(4.0f);
+    __m512 zx = lanes.zx;
+    __m512 zy = lanes.zy;
+
+    __m512 xtemp = _mm512_add_ps(_mm512_sub_ps(_mm512_mul_ps(zx, zx), _mm512_mul_ps(zy, zy)), lanes.cx);
+    zy = _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(two, zx), zy), lanes.cy);
+    zx = xtemp;
+    lanes.zx = zx;
+    lanes.zy = zy;
+
+    __m512 magnitude = _mm512_add_ps(_mm512_mul_ps(zx, zx), _mm512_mul_ps(zy, zy));
+    __mmask16 escaped = _mm512_mask_cmp_ps_mask(lanes.active, magnitude, four, _CMP_GT_OQ);
+    // Active lanes that did not escape completed one more iteration
+    __mmask16 continued = static_cast<__mmask16>(lanes.active & ~escaped);
+    lanes.n = _mm512_mask_add_epi32(lanes.n, continued, lanes.n, _mm512_set1_epi32(1));
+    return static_cast<__mmask16>(escaped | _mm512_mask_cmpeq_epi32_mask(lanes.active, lanes.n, max_v));
+}
+
+// Scatters the results of the done lanes, expands the next pending point indices into them and gathers
+// their coordinates.
+KERNEL_TARGET("avx512f")
+void refill_lanes(FloatLanes& lanes, __mmask16 done, const float* cx, const float* cy, int count, int& next,
+                  uint32_t* out) {
+    const __m512i sequence = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    _mm512_mask_i32scatter_epi32(out, static_cast<__mmask16>(done & lanes.active), lanes.point, lanes.n, 4);
+
+    __mmask16 refill = static_cast<__mmask16>(lowest_bits(done, count - next));
+    lanes.point = _mm512_mask_expand_epi32(lanes.point, refill, _mm512_add_epi32(sequence, _mm512_set1_epi32(next)));
+    next += bit_count(refill);
+    lanes.cx = _mm512_mask_i32gather_ps(lanes.cx, refill, lanes.point, cx, 4);
+    lanes.cy = _mm512_mask_i32gather_ps(lanes.cy, refill, lanes.point, cy, 4);
+    lanes.zx = _mm512_mask_mov_ps(lanes.zx, refill, lanes.cx);
+    lanes.zy = _mm512_mask_mov_ps(lanes.zy, refill, lanes.cy);
+    lanes.n = _mm512_mask_mov_epi32(lanes.n, refill, _mm512_setzero_si512());
+    lanes.active = static_cast<__mmask16>((lanes.active & ~done) | refill);
+}
+
+// FloatLanes for doubles. Point indices are 64-bit to match the lanes, the counters are 32-bit and use only
+// the lower 8 lanes of their register.
+struct DoubleLanes {
+    __m512d cx, cy, zx, zy;
+    __m512i n, point;
+    __mmask8 active;
+};
+
+KERNEL_TARGET("avx512f")
+inline __mmask8 step_lanes(DoubleLanes& lanes, __m512i max_v) {
+    const __m512d two = _mm512_set1_pd(2.0);
+    const __m512d four = _mm512_set1_pd(4.0);
+    __m512d zx = lanes.zx;
+    __m512d zy = lanes.zy;
+
+    __m512d xtemp = _mm512_add_pd(_mm512_sub_pd(_mm512_mul_pd(zx, zx), _mm512_mul_pd(zy, zy)), lanes.cx);
+    zy = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(two, zx), zy), lanes.cy);
+    zx = xtemp;
+    lanes.zx = zx;
+    lanes.zy = zy;
+
+    __m512d magnitude = _mm512_add_pd(_mm512_mul_pd(zx, zx), _mm512_mul_pd(zy, zy));
+    __mmask8 escaped = _mm512_mask_cmp_pd_mask(lanes.active, magnitude, four, _CMP_GT_OQ);
+    __mmask8 continued = static_cast<__mmask8>(lanes.active & ~escaped);
+    lanes.n = _mm512_mask_add_epi32(lanes.n, continued, lanes.n, _mm512_set1_epi32(1));
+    return static_cast<__mmask8>(escaped | _mm512_mask_cmpeq_epi32_mask(lanes.active, lanes.n, max_v));
+}
+
+KERNEL_TARGET("avx512f")
+void refill_lanes(DoubleLanes& lanes, __mmask8 done, const double* cx, const double* cy, int count, int& next,
+                  uint32_t* out) {
+    const __m512i sequence = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+
+    // Lanes finish rarely compared to iterations, so the results are simply written one by one
+    alignas(64) int64_t lane_point[8];
+    alignas(64) uint32_t lane_n[16];
+    _mm512_store_si512(lane_point, lanes.point);
+    _mm512_store_si512(lane_n, lanes.n);
+    for (int l = 0; l < 8; l++) {
+        if (done & lanes.active & (1 << l)) out[lane_point[l]] = lane_n[l];
+    }
+
+    __mmask8 refill = static_cast<__mmask8>(lowest_bits(done, count - next));
+    lanes.point = _mm512_mask_expand_epi64(lanes.point, refill, _mm512_add_epi64(sequence, _mm512_set1_epi64(next)));
+    next += bit_count(refill);
+    lanes.cx = _mm512_mask_i64gather_pd(lanes.cx, refill, lanes.point, cx, 8);
+    lanes.cy = _mm512_mask_i64gather_pd(lanes.cy, refill, lanes.point, cy, 8);
+    lanes.zx = _mm512_mask_mov_pd(lanes.zx, refill, lanes.cx);
+    lanes.zy = _mm512_mask_mov_pd(lanes.zy, refill, lanes.cy);
+    lanes.n = _mm512_mask_mov_epi32(lanes.n, refill, _mm512_setzero_si512());
+    lanes.active = static_cast<__mmask8>((lanes.active & ~done) | refill);
+}
+
+}  // namespace
+
+KERNEL_TARGET("avx512f")
+void refill_float_avx512(const float* cx, const float* cy, int count, int max_iterations, uint32_t* out) {
+    if (max_iterations <= 0) {
+        for (int k = 0; k < count; k++) out[k] = 0;
+        return;
+    }
+    const __m512i max_v = _mm512_set1_epi32(max_iterations);
+
+    FloatLanes a;
+    a.cx = a.cy = a.zx = a.zy = _mm512_setzero_ps();
+    a.n = a.point = _mm512_setzero_si512();
+    a.active = 0;
+    FloatLanes b = a;
+    int next = 0;
+    refill_lanes(a, 0xffff, cx, cy, count, next, out);
+    refill_lanes(b, 0xffff, cx, cy, count, next, out);
+
+    while ((a.active | b.active) != 0) {
+        __mmask16 done_a = step_lanes(a, max_v);
+        __mmask16 done_b = step_lanes(b, max_v);
+        if (done_a != 0) refill_lanes(a, done_a, cx, cy, count, next, out);
+        if (done_b != 0) refill_lanes(b, done_b, cx, cy, count, next, out);
+    }
+}
+
+KERNEL_TARGET("avx512f")
+void refill_double_avx512(const double* cx, const double* cy, int count, int max_iterations, uint32_t* out) {
+    if (max_iterations <= 0) {
+        for (int k = 0; k < count; k++) out[k] = 0;
+        return;
+    }
+    const __m512i max_v = _mm512_set1_epi32(max_iterations);
+
+    DoubleLanes a;
+    a.cx = a.cy = a.zx = a.zy = _mm512_setzero_pd();
+    a.n = a.point = _mm512_setzero_si512();
+    a.active = 0;
+    DoubleLanes b = a;
+    int next = 0;
+    refill_lanes(a, 0xff, cx, cy, count, next, out);
+    refill_lanes(b, 0xff, cx, cy, count, next, out);
+
+    while ((a.active | b.active) != 0) {
+        __mmask8 done_a = step_lanes(a, max_v);
+        __mmask8 done_b = step_lanes(b, max_v);
+        if (done_a != 0) refill_lanes(a, done_a, cx, cy, count, next, out);
+        if (done_b != 0) refill_lanes(b, done_b, cx, cy, count, next, out);
+    }
+}
+
+#endif
@@ -0,0 +1,277 @@
+#include "escape_kernels.h"
+
+#if ESCAPE_KERNELS_X86
+
+#include <immintrin.h>
+
+// SSE2 has no blend or masked load, so partial vectors are padded with the last point and written back lane by lane
+
+namespace {
+
+// One vector of lanes working through the shared point queue. Two of them are iterated side by side so one
+// hides the latency of the other's dependency chain.
+struct FloatLanes {
+    __m128 cx, cy, zx, zy;
+    __m128i n;
+    __m128 active;
+    int point[4];
+};
+
+KERNEL_TARGET("sse2")
+inline int step_lanes(FloatLanes& lanes, __m128i max_v) {
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 four = _mm_set1_ps(4.0f);
+    __m128 zx = lanes.zx;
+    __m128 zy = lanes.zy;
+
+    __m128 xtemp = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(zx, zx), _mm_mul_ps(zy, zy)), lanes.cx);
+    zy = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(two, zx), zy), lanes.cy);
+    zx = xtemp;
+    lanes.zx = zx;
+    lanes.zy = zy;
+
+    __m128 magnitude = _mm_add_ps(_mm_mul_ps(zx, zx), _mm_mul_ps(zy, zy));
+    __m128 escaped = _mm_and_ps(_mm_cmpgt_ps(magnitude, four), lanes.active);
+    // Active lanes that did not escape completed one more iteration
+    __m128i continued = _mm_andnot_si128(_mm_castps_si128(escaped), _mm_castps_si128(lanes.active));
+    lanes.n = _mm_sub_epi32(lanes.n, continued);
+    __m128 at_limit = _mm_castsi128_ps(_mm_cmpeq_epi32(lanes.n, max_v));
+    return _mm_movemask_ps(_mm_or_ps(escaped, _mm_and_ps(lanes.active, at_limit)));
+}
+
+// Writes out the results of the done lanes and loads the next pending points into them. The lane state is
+// spilled to memory and patched in scalar code.
+KERNEL_TARGET("sse2")
+void refill_lanes(FloatLanes& lanes, int done_lanes, const float* cx, const float* cy, int count, int& next,
+                  uint32_t* out) {
+    alignas(16) float lane_cx[4], lane_cy[4], lane_zx[4], lane_zy[4];
+    alignas(16) int32_t lane_n[4];
+    alignas(16) int32_t lane_active[4];
+    _mm_store_ps(lane_cx, lanes.cx);
+    _mm_store_ps(lane_cy, lanes.cy);
+    _mm_store_ps(lane_zx, lanes.zx);
+    _mm_store_ps(lane_zy, lanes.zy);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lane_n), lanes.n);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lane_active), _mm_castps_si128(lanes.active));
+
+    for (int l = 0; l < 4; l++) {
+        if ((done_lanes & (1 << l)) == 0) continue;
+        if (lanes.point[l] >= 0) out[lanes.point[l]] = static_cast<uint32_t>(lane_n[l]);
+        if (next < count) {
+            lanes.point[l] = next;
+            lane_cx[l] = lane_zx[l] = cx[next];
+            lane_cy[l] = lane_zy[l] = cy[next];
+            lane_n[l] = 0;
+            lane_active[l] = -1;
+            next++;
+        } else {
+            lanes.point[l] = -1;
+            lane_active[l] = 0;
+        }
+    }
+
+    lanes.cx = _mm_load_ps(lane_cx);
+    lanes.cy = _mm_load_ps(lane_cy);
+    lanes.zx = _mm_load_ps(lane_zx);
+    lanes.zy = _mm_load_ps(lane_zy);
+    lanes.n = _mm_load_si128(reinterpret_cast<const __m128i*>(lane_n));
+    lanes.active = _mm_castsi128_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(lane_active)));
+}
+
+// FloatLanes for doubles
+struct DoubleLanes {
+    __m128d cx, cy, zx, zy;
+    __m128d n;
+    __m128d active;
+    int point[2];
+};
+
+KERNEL_TARGET("sse2")
+inline int step_lanes(DoubleLanes& lanes, __m128d max_v) {
+    const __m128d two = _mm_set1_pd(2.0);
+    const __m128d four = _mm_set1_pd(4.0);
+    __m128d zx = lanes.zx;
+    __m128d zy = lanes.zy;
+
+    __m128d xtemp = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(zx, zx), _mm_mul_pd(zy, zy)), lanes.cx);
+    zy = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(two, zx), zy), lanes.cy);
+    zx = xtemp;
+    lanes.zx = zx;
+    lanes.zy = zy;
+
+    __m128d magnitude = _mm_add_pd(_mm_mul_pd(zx, zx), _mm_mul_pd(zy, zy));
+    __m128d escaped = _mm_and_pd(_mm_cmpgt_pd(magnitude, four), lanes.active);
+    // Active lanes that did not escape completed one more iteration, counts are exact in a double
+    lanes.n = _mm_add_pd(lanes.n, _mm_and_pd(_mm_andnot_pd(escaped, lanes.active), _mm_set1_pd(1.0)));
+    __m128d at_limit = _mm_cmpeq_pd(lanes.n, max_v);
+    return _mm_movemask_pd(_mm_or_pd(escaped, _mm_and_pd(lanes.active, at_limit)));
+}
+
+// Writes out the results of the done lanes and loads the next pending points into them. The lane state is
+// spilled to memory and patched in scalar code.
+KERNEL_TARGET("sse2")
+void refill_lanes(DoubleLanes& lanes, int done_lanes, const double* cx, const double* cy, int count, int& next,
+                  uint32_t* out) {
+    alignas(16) double lane_cx[2], lane_cy[2], lane_zx[2], lane_zy[2];
+    alignas(16) double lane_n[2];
+    alignas(16) int64_t lane_active[2];
+    _mm_store_pd(lane_cx, lanes.cx);
+    _mm_store_pd(lane_cy, lanes.cy);
+    _mm_store_pd(lane_zx, lanes.zx);
+    _mm_store_pd(lane_zy, lanes.zy);
+    _mm_store_pd(lane_n, lanes.n);
+    _mm_store_pd(reinterpret_cast<double*>(lane_active), lanes.active);
+
+    for (int l = 0; l < 2; l++) {
+        if ((done_lanes & (1 << l)) == 0) continue;
+        if (lanes.point[l] >= 0) out[lanes.point[l]] = static_cast<uint32_t>(lane_n[l]);
+        if (next < count) {
+            lanes.point[l] = next;
+            lane_cx[l] = lane_zx[l] = cx[next];
+            lane_cy[l] = lane_zy[l] = cy[next];
+            lane_n[l] = 0.0;
+            lane_active[l] = -1;
+            next++;
+        } else {
+            lanes.point[l] = -1;
+            lane_active[l] = 0;
+        }
+    }
+
+    lanes.cx = _mm_load_pd(lane_cx);
+    lanes.cy = _mm_load_pd(lane_cy);
+    lanes.zx = _mm_load_pd(lane_zx);
+    lanes.zy = _mm_load_pd(lane_zy);
+    lanes.n = _mm_load_pd(lane_n);
+    lanes.active = _mm_load_pd(reinterpret_cast<const double*>(lane_active));
+}
+
+}  // namespace
+
+KERNEL_TARGET("sse2")
+void escape_float_sse2(const float* cx, float cy, int count, int max_iterations, uint32_t* out) {
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 four = _mm_set1_ps(4.0f);
+    const __m128 cy_v = _mm_set1_ps(cy);
+
+    for (int base = 0; base < count; base += 4) {
+        int lanes = count - base < 4 ? count - base : 4;
+        alignas(16) float lane_cx[4];
+        for (int k = 0; k < 4; k++) {
+            lane_cx[k] = cx[base + (k < lanes ? k : lanes - 1)];
+        }
+
+        __m128 cx_v = _mm_load_ps(lane_cx);
+        __m128 zx = cx_v;
+        __m128 zy = cy_v;
+        __m128i iterations = _mm_set1_epi32(max_iterations);
+        __m128 active = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (int i = 0; i < max_iterations; i++) {
+            __m128 xtemp = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(zx, zx), _mm_mul_ps(zy, zy)), cx_v);
+            zy = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(two, zx), zy), cy_v);
+            zx = xtemp;
+
+            __m128 magnitude = _mm_add_ps(_mm_mul_ps(zx, zx), _mm_mul_ps(zy, zy));
+            __m128i escaped = _mm_castps_si128(_mm_and_ps(_mm_cmpgt_ps(magnitude, four), active));
+            iterations = _mm_or_si128(_mm_andnot_si128(escaped, iterations), _mm_and_si128(escaped, _mm_set1_epi32(i)));
+            active = _mm_andnot_ps(_mm_castsi128_ps(escaped), active);
+            if (_mm_movemask_ps(active) == 0) break;
+        }
+
+        alignas(16) uint32_t lane_out[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lane_out), iterations);
+        for (int k = 0; k < lanes; k++) {
+            out[base + k] = lane_out[k];
+        }
+    }
+}
+
+KERNEL_TARGET("sse2")
+void escape_double_sse2(const double* cx, double cy, int count, int max_iterations, uint32_t* out) {
+    const __m128d two = _mm_set1_pd(2.0);
+    const __m128d four = _mm_set1_pd(4.0);
+    const __m128d cy_v = _mm_set1_pd(cy);
+
+    for (int base = 0; base < count; base += 2) {
+        int lanes = count - base < 2 ? count - base : 2;
+        __m128d cx_v = _mm_set_pd(cx[base + lanes - 1], cx[base]);
+        __m128d zx = cx_v;
+        __m128d zy = cy_v;
+        // Iteration counts are exact in a double, which saves converting masks between element widths
+        __m128d iterations = _mm_set1_pd(max_iterations);
+        __m128d active = _mm_castsi128_pd(_mm_set1_epi32(-1));
+
+        for (int i = 0; i < max_iterations; i++) {
+            __m128d xtemp = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(zx, zx), _mm_mul_pd(zy, zy)), cx_v);
+            zy = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(two, zx), zy), cy_v);
+            zx = xtemp;
+
+            __m128d magnitude = _mm_add_pd(_mm_mul_pd(zx, zx), _mm_mul_pd(zy, zy));
+            __m128d escaped = _mm_and_pd(_mm_cmpgt_pd(magnitude, four), active);
+            iterations = _mm_or_pd(_mm_andnot_pd(escaped, iterations), _mm_and_pd(escaped, _mm_set1_pd(i)));
+            active = _mm_andnot_pd(escaped, active);
+            if (_mm_movemask_pd(active) == 0) break;
+        }
+
+        alignas(16) double lane_out[2];
+        _mm_store_pd(lane_out, iterations);
+        for (int k = 0; k < lanes; k++) {
+            out[base + k] = static_cast<uint32_t>(lane_out[k]);
+        }
+    }
+}
+
+KERNEL_TARGET("sse2")
+void refill_float_sse2(const float* cx, const float* cy, int count, int max_iterations, uint32_t* out) {
+    if (max_iterations <= 0) {
+        for (int k = 0; k < count; k++) out[k] = 0;
+        return;
+    }
+    const __m128i max_v = _mm_set1_epi32(max_iterations);
+    const int all_lanes = (1 << 4) - 1;
+
+    FloatLanes a;
+    a.cx = a.cy = a.zx = a.zy = a.active = _mm_setzero_ps();
+    a.n = _mm_setzero_si128();
+    for (int l = 0; l < 4; l++) a.point[l] = -1;
+    FloatLanes b = a;
+    int next = 0;
+    refill_lanes(a, all_lanes, cx, cy, count, next, out);
+    refill_lanes(b, all_lanes, cx, cy, count, next, out);
+
+    while ((_mm_movemask_ps(a.active) | _mm_movemask_ps(b.active)) != 0) {
+        int done_a = step_lanes(a, max_v);
+        int done_b = step_lanes(b, max_v);
+        if (done_a != 0) refill_lanes(a, done_a, cx, cy, count, next, out);
+        if (done_b != 0) refill_lanes(b, done_b, cx, cy, count, next, out);
+    }
+}
+
+KERNEL_TARGET("sse2")
+void refill_double_sse2(const double* cx, const double* cy, int count, int max_iterations, uint32_t* out) {
+    if (max_iterations <= 0) {
+        for (int k = 0; k < count; k++) out[k] = 0;
+        return;
+    }
+    const __m128d max_v = _mm_set1_pd(max_iterations);
+    const int all_lanes = (1 << 2) - 1;
+
+    DoubleLanes a;
+    a.cx = a.cy = a.zx = a.zy = a.active = _mm_setzero_pd();
+    a.n = _mm_setzero_pd();
+    for (int l = 0; l < 2; l++) a.point[l] = -1;
+    DoubleLanes b = a;
+    int next = 0;
+    refill_lanes(a, all_lanes, cx, cy, count, next, out);
+    refill_lanes(b, all_lanes, cx, cy, count, next, out);
+
+    while ((_mm_movemask_pd(a.active) | _mm_movemask_pd(b.active)) != 0) {
+        int done_a = step_lanes(a, max_v);
+        int done_b = step_lanes(b, max_v);
+        if (done_a != 0) refill_lanes(a, done_a, cx, cy, count, next, out);
+        if (done_b != 0) refill_lanes(b, done_b, cx, cy, count, next, out);
+    }
+}
+
+#endif
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+
+#if !defined(__SIZEOF_INT128__) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+// Signed fixed-point number in 128-bit two's complement, 3 integer bits and 124 after the binary point, so values lie
+// in [-8, 8). Every operation is on integers and products are truncated toward zero, which makes the results the same
+// under any compiler and any floating-point flags.
+struct Fixed128 {
+    static constexpr int fraction_bits = 124;
+
+    uint64_t hi;
+    uint64_t lo;
+
+    // value must lie in [-8, 8)
+    static Fixed128 from_int(int value) {
+        return {static_cast<uint64_t>(static_cast<int64_t>(value)) << (fraction_bits - 64), 0};
+    }
+
+    bool is_negative() const { return static_cast<int64_t>(hi) < 0; }
+};
+
+// 128-bit product of a and b, returns the low half
+inline uint64_t multiply_words(uint64_t a, uint64_t b, uint64_t& hi) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 p = static_cast<unsigned __int128>(a) * b;
+    hi = static_cast<uint64_t>(p >> 64);
+    return static_cast<uint64_t>(p);
+#elif defined(_M_X64)
+    return _umul128(a, b, &hi);
+#else
+    uint64_t a0 = a & 0xffffffff;
+    uint64_t a1 = a >> 32;
+    uint64_t b0 = b & 0xffffffff;
+    uint64_t b1 = b >> 32;
+    uint64_t low = a0 * b0;
+    uint64_t middle = a1 * b0 + (low >> 32);
+    uint64_t middle2 = a0 * b1 + (middle & 0xffffffff);
+    hi = a1 * b1 + (middle >> 32) + (middle2 >> 32);
+    return (middle2 << 32) | (low & 0xffffffff);
+#endif
+}
+
+inline Fixed128 operator+(const Fixed128& a, const Fixed128& b) {
+    uint64_t lo = a.lo + b.lo;
+    return {a.hi + b.hi + (lo < a.lo), lo};
+}
+
+inline Fixed128 operator-(const Fixed128& a) {
+    uint64_t lo = ~a.lo + 1;
+    return {~a.hi + (lo == 0), lo};
+}
+
+inline Fixed128 operator-(const Fixed128& a, const Fixed128& b) {
+    uint64_t lo = a.lo - b.lo;
+    return {a.hi - b.hi - (a.lo < b.lo), lo};
+}
+
+inline bool operator<(const Fixed128& a, const Fixed128& b) {
+    if (a.hi != b.hi) return static_cast<int64_t>(a.hi) < static_cast<int64_t>(b.hi);
+    return a.lo < b.lo;
+}
+
+inline bool operator>(const Fixed128& a, const Fixed128& b) { return b < a; }
+
+inline Fixed128 abs(const Fixed128& a) { return a.is_negative() ? -a : a; }
+
+// Exact as long as the result stays in range
+inline Fixed128 times_two(const Fixed128& a) { return {(a.hi << 1) | (a.lo >> 63), a.lo << 1}; }
+
+// Magnitude of a * b, or of a² when a and b are the same, shifted back to fraction_bits. Both must be non-negative.
+inline Fixed128 multiply_magnitudes(const Fixed128& a, const Fixed128& b, bool square) {
+    // Only the high half of the lowest product reaches bit 124
+    uint64_t w1;
+    multiply_words(a.lo, b.lo, w1);
+    uint64_t w3;
+    uint64_t w2 = multiply_words(a.hi, b.hi, w3);
+
+    // The high words are at most 2^63, so each cross product is below 2^127 and their sum fits in 128 bits
+    uint64_t cross_hi;
+    uint64_t cross_lo = multiply_words(a.hi, b.lo, cross_hi);
+    if (square) {
+        cross_hi = (cross_hi << 1) | (cross_lo >> 63);
+        cross_lo <<= 1;
+    } else {
+        uint64_t other_hi;
+        uint64_t other_lo = multiply_words(a.lo, b.hi, other_hi);
+        cross_lo += other_lo;
+        cross_hi += other_hi + (cross_lo < other_lo);
+    }
+
+    w1 += cross_lo;
+    uint64_t carry = w1 < cross_lo;
+    w2 += carry;
+    w3 += w2 < carry;
+    w2 += cross_hi;
+    w3 += w2 < cross_hi;
+
+    const int shift = Fixed128::fraction_bits - 64;
+    return {(w3 << (64 - shift)) | (w2 >> shift), (w2 << (64 - shift)) | (w1 >> shift)};
+}
+
+// Truncated toward zero, the result must stay in range
+inline Fixed128 operator*(const Fixed128& a, const Fixed128& b) {
+    Fixed128 magnitude = multiply_magnitudes(abs(a), abs(b), false);
+    return a.is_negative() != b.is_negative() ? -magnitude : magnitude;
+}
+
+inline Fixed128 square(const Fixed128& a) {
+    Fixed128 magnitude = abs(a);
+    return multiply_magnitudes(magnitude, magnitude, true);
+}
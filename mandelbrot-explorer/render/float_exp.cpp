@@ -0,0 +1,87 @@
+#include "float_exp.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+bool FloatExp::parse(const std::string& text, FloatExp& value) {
+    // Split into the digits strtod can take and the decimal exponent it might not
+    size_t pos = 0;
+    if (pos < text.size() && (text[pos] == '-' || text[pos] == '+')) {
+        pos++;
+    }
+    size_t digits = 0;
+    bool point = false;
+    while (pos < text.size() && ((text[pos] >= '0' && text[pos] <= '9') || (text[pos] == '.' && !point))) {
+        point = point || text[pos] == '.';
+        digits += text[pos] != '.';
+        pos++;
+    }
+    if (digits == 0) {
+        return false;
+    }
+    std::string significand = text.substr(0, pos);
+
+    long long decimal_exponent = 0;
+    if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+        const char* begin = text.c_str() + pos + 1;
+        char* end = nullptr;
+        decimal_exponent = std::strtoll(begin, &end, 10);
+        if (end == begin) {
+            return false;
+        }
+        pos = end - text.c_str();
+    }
+    if (pos != text.size()) {
+        return false;
+    }
+
+    // 10^|decimal_exponent| by repeated squaring, with a rounding error of a few ulps
+    FloatExp power = 1.0;
+    FloatExp square = 10.0;
+    for (unsigned long long rest = std::llabs(decimal_exponent); rest != 0; rest >>= 1) {
+        if (rest & 1) {
+            power = power * square;
+        }
+        square = square * square;
+    }
+
+    FloatExp result = std::strtod(significand.c_str(), nullptr);
+    value = decimal_exponent < 0 ? result / power : result * power;
+    return true;
+}
+
+double FloatExp::to_double() const {
+    if (exponent_value > 1023) {
+        return mantissa_value < 0.0 ? -HUGE_VAL : HUGE_VAL;
+    }
+    if (exponent_value < -1075) {
+        return 0.0;
+    }
+    return std::ldexp(mantissa_value, static_cast<int>(exponent_value));
+}
+
+double FloatExp::log2() const {
+    return std::log2(std::fabs(mantissa_value)) + static_cast<double>(exponent_value);
+}
+
+std::string FloatExp::to_string(int digits) const {
+    if (is_zero()) {
+        return "0";
+    }
+    // mantissa * 2^exponent = 10^(decimal_exponent + fraction)
+    double log10_value =
+        std::log10(std::fabs(mantissa_value)) + static_cast<double>(exponent_value) * std::log10(2.0);
+    double decimal_exponent = std::floor(log10_value);
+    double significand = std::pow(10.0, log10_value - decimal_exponent);
+    // Rounding to digits can carry into the next power of ten
+    if (significand + 0.5 * std::pow(10.0, -digits) >= 10.0) {
+        significand /= 10.0;
+        decimal_exponent += 1.0;
+    }
+
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%s%.*fe%lld", mantissa_value < 0.0 ? "-" : "", digits, significand,
+             static_cast<long long>(decimal_exponent));
+    return buffer;
+}
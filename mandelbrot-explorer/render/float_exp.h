@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Floating point number with a double mantissa and a separate 64-bit exponent, value = mantissa * 2^exponent.
+// Covers the magnitudes of pixel offsets and zoom factors far beyond 1e±308 at the precision of a double. The
+// mantissa is kept in [1, 2) in magnitude, or 0, so products and quotients only need one comparison to rescale.
+// Results are rounded exactly like the same double operation whenever that one neither overflows nor underflows.
+class FloatExp {
+   public:
+    FloatExp() = default;
+
+    // Any finite double
+    FloatExp(double value) : mantissa_value(value), exponent_value(0) { normalize(); }
+
+    // mantissa * 2^exponent, mantissa can be any finite double
+    FloatExp(double mantissa, int64_t exponent) : mantissa_value(mantissa), exponent_value(exponent) {
+        normalize();
+    }
+
+    // Parses a decimal like "2.5e-1000" that may lie outside the range of a double. Returns false if text is not a
+    // plain decimal number with an optional exponent.
+    static bool parse(const std::string& text, FloatExp& value);
+
+    double mantissa() const { return mantissa_value; }
+    int64_t exponent() const { return exponent_value; }
+    bool is_zero() const { return mantissa_value == 0.0; }
+
+    // ±infinity beyond the range of a double, 0 below it
+    double to_double() const;
+
+    // log2 of the magnitude
+    double log2() const;
+
+    // Decimal with digits after the point, like "1.234e-500"
+    std::string to_string(int digits = 6) const;
+
+    FloatExp operator-() const {
+        FloatExp result = *this;
+        result.mantissa_value = -mantissa_value;
+        return result;
+    }
+
+    friend FloatExp operator*(const FloatExp& a, const FloatExp& b) {
+        FloatExp result;
+        result.mantissa_value = a.mantissa_value * b.mantissa_value;
+        result.exponent_value = a.exponent_value + b.exponent_value;
+        // [1, 4) in magnitude, unless one of them is zero
+        if (result.mantissa_value >= 2.0 || result.mantissa_value <= -2.0) {
+            result.mantissa_value *= 0.5;
+            result.exponent_value++;
+        } else if (result.mantissa_value == 0.0) {
+            result.exponent_value = zero_exponent;
+        }
+        return result;
+    }
+
+    friend FloatExp operator/(const FloatExp& a, const FloatExp& b) {
+        FloatExp result;
+        result.mantissa_value = a.mantissa_value / b.mantissa_value;
+        result.exponent_value = a.exponent_value - b.exponent_value;
+        // (0.5, 2) in magnitude, unless a is zero
+        if (result.mantissa_value < 1.0 && result.mantissa_value > -1.0) {
+            if (result.mantissa_value == 0.0) {
+                result.exponent_value = zero_exponent;
+                return result;
+            }
+            result.mantissa_value *= 2.0;
+            result.exponent_value--;
+        }
+        return result;
+    }
+
+    friend FloatExp operator+(const FloatExp& a, const FloatExp& b) {
+        const FloatExp& larger = a.exponent_value >= b.exponent_value ? a : b;
+        const FloatExp& smaller = a.exponent_value >= b.exponent_value ? b : a;
+        int64_t shift = larger.exponent_value - smaller.exponent_value;
+        // Below 2^-64 of the larger mantissa, the smaller one no longer changes the rounded sum
+        if (shift > 64) {
+            return larger;
+        }
+        double aligned = smaller.mantissa_value * power_of_two(-static_cast<int>(shift));
+        return FloatExp(larger.mantissa_value + aligned, larger.exponent_value);
+    }
+
+    friend FloatExp operator-(const FloatExp& a, const FloatExp& b) { return a + -b; }
+
+    friend FloatExp sqrt(const FloatExp& value) {
+        // An even exponent halves exactly
+        int64_t odd = value.exponent_value & 1;
+        return FloatExp(std::sqrt(odd ? 2.0 * value.mantissa_value : value.mantissa_value),
+                        (value.exponent_value - odd) / 2);
+    }
+
+    friend bool operator<(const FloatExp& a, const FloatExp& b) {
+        bool a_negative = a.mantissa_value < 0.0;
+        bool b_negative = b.mantissa_value < 0.0;
+        if (a_negative != b_negative) {
+            return a_negative;
+        }
+        if (a.is_zero() || b.is_zero()) {
+            return a.mantissa_value < b.mantissa_value;
+        }
+        if (a.exponent_value != b.exponent_value) {
+            return (a.exponent_value < b.exponent_value) != a_negative;
+        }
+        return a.mantissa_value < b.mantissa_value;
+    }
+
+    friend bool operator>(const FloatExp& a, const FloatExp& b) { return b < a; }
+    friend bool operator<=(const FloatExp& a, const FloatExp& b) { return !(b < a); }
+    friend bool operator>=(const FloatExp& a, const FloatExp& b) { return !(a < b); }
+
+   private:
+    // Exponent of zero, low enough that adding zero to anything returns the other operand
+    static constexpr int64_t zero_exponent = INT64_MIN / 4;
+
+    // 2^exponent for exponents a double can hold as a normal number
+    static double power_of_two(int exponent) {
+        uint64_t bits = static_cast<uint64_t>(exponent + 1023) << 52;
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // Moves the binary exponent of mantissa_value into exponent_value by rewriting the exponent bits
+    void normalize() {
+        uint64_t bits;
+        std::memcpy(&bits, &mantissa_value, sizeof(bits));
+        int biased = static_cast<int>((bits >> 52) & 0x7ff);
+        if (biased == 0) {
+            if (mantissa_value == 0.0) {
+                exponent_value = zero_exponent;
+                return;
+            }
+            // Subnormal, scale it into the normal range first
+            mantissa_value *= power_of_two(64);
+            exponent_value -= 64;
+            std::memcpy(&bits, &mantissa_value, sizeof(bits));
+            biased = static_cast<int>((bits >> 52) & 0x7ff);
+        }
+        exponent_value += biased - 1023;
+        bits = (bits & ~(uint64_t(0x7ff) << 52)) | (uint64_t(1023) << 52);
+        std::memcpy(&mantissa_value, &bits, sizeof(mantissa_value));
+    }
+
+    double mantissa_value = 0.0;
+    int64_t exponent_value = zero_exponent;
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+// Unevaluated sums x[0] + x[1] + ... of N doubles, each term holding the rounding error of the ones before it.
+// Double-double has about 106 bits of mantissa, quad-double about 212. The operations follow Hida, Li and Bailey's QD
+// library, except that quad-double renormalization skips its zero tests, so the SIMD kernels can run the same
+// operations in every lane. They only work if the compiler neither fuses nor reorders them (-ffp-contract=off).
+template <int N>
+struct MultiDouble {
+    double x[N];
+};
+
+using DoubleDouble = MultiDouble<2>;
+using QuadDouble = MultiDouble<4>;
+
+// s + e = a + b exactly
+inline double two_sum(double a, double b, double& e) {
+    double s = a + b;
+    double v = s - a;
+    e = (a - (s - v)) + (b - v);
+    return s;
+}
+
+// Same for |a| >= |b|, in fewer operations
+inline double quick_two_sum(double a, double b, double& e) {
+    double s = a + b;
+    e = b - (s - a);
+    return s;
+}
+
+// p + e = a * b exactly. Dekker's product splits the factors into 26-bit halves whose products are exact, which gives
+// the same e as fma(a, b, -p) on CPUs without fma.
+inline double two_product(double a, double b, double& e) {
+    const double split = 134217729.0;  // 2^27 + 1
+    double p = a * b;
+    double ta = split * a;
+    double a_hi = ta - (ta - a);
+    double a_lo = a - a_hi;
+    double tb = split * b;
+    double b_hi = tb - (tb - b);
+    double b_lo = b - b_hi;
+    e = ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+    return p;
+}
+
+// Multiplying every term by two is exact
+template <int N>
+MultiDouble<N> times_two(const MultiDouble<N>& a) {
+    MultiDouble<N> result;
+    for (int k = 0; k < N; k++) {
+        result.x[k] = 2.0 * a.x[k];
+    }
+    return result;
+}
+
+template <int N>
+MultiDouble<N> operator-(const MultiDouble<N>& a) {
+    MultiDouble<N> result;
+    for (int k = 0; k < N; k++) {
+        result.x[k] = -a.x[k];
+    }
+    return result;
+}
+
+// The accurate double-double sum, which keeps its relative error small even when a and b cancel
+inline DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b) {
+    double e1;
+    double e2;
+    double s1 = two_sum(a.x[0], b.x[0], e1);
+    double s2 = two_sum(a.x[1], b.x[1], e2);
+    e1 += s2;
+    s1 = quick_two_sum(s1, e1, e1);
+    e1 += e2;
+    s1 = quick_two_sum(s1, e1, e1);
+    return {{s1, e1}};
+}
+
+inline DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b) {
+    double e;
+    double p = two_product(a.x[0], b.x[0], e);
+    e += a.x[0] * b.x[1] + a.x[1] * b.x[0];
+    p = quick_two_sum(p, e, e);
+    return {{p, e}};
+}
+
+// a + b + c = a' + b' + c' with a' the rounded sum
+inline void three_sum(double& a, double& b, double& c) {
+    double t2;
+    double t3;
+    double t1 = two_sum(a, b, t2);
+    a = two_sum(c, t1, t3);
+    b = two_sum(t2, t3, c);
+}
+
+// Same, rounding the last two terms into b
+inline void three_sum2(double& a, double& b, double c) {
+    double t2;
+    double t3;
+    double t1 = two_sum(a, b, t2);
+    a = two_sum(c, t1, t3);
+    b = t2 + t3;
+}
+
+// Turns five overlapping terms into four that do not overlap, from the bottom up and back down
+inline QuadDouble renormalize(double c0, double c1, double c2, double c3, double c4) {
+    double s = quick_two_sum(c3, c4, c4);
+    s = quick_two_sum(c2, s, c3);
+    s = quick_two_sum(c1, s, c2);
+    c0 = quick_two_sum(c0, s, c1);
+    c1 = quick_two_sum(c1, c2, c2);
+    c2 = quick_two_sum(c2, c3, c3);
+    c3 += c4;
+    return {{c0, c1, c2, c3}};
+}
+
+// QD's sloppy sum, its error is relative to |a| + |b|, which is fine for points bounded by the escape radius
+inline QuadDouble operator+(const QuadDouble& a, const QuadDouble& b) {
+    double t0;
+    double t1;
+    double t2;
+    double t3;
+    double s0 = two_sum(a.x[0], b.x[0], t0);
+    double s1 = two_sum(a.x[1], b.x[1], t1);
+    double s2 = two_sum(a.x[2], b.x[2], t2);
+    double s3 = two_sum(a.x[3], b.x[3], t3);
+    s1 = two_sum(s1, t0, t0);
+    three_sum(s2, t0, t1);
+    three_sum2(s3, t0, t2);
+    t0 = t0 + t1 + t3;
+    return renormalize(s0, s1, s2, s3, t0);
+}
+
+// Products of the terms down to order 3 in the rounding error of a double, the rest is dropped
+inline QuadDouble operator*(const QuadDouble& a, const QuadDouble& b) {
+    double q0;
+    double q1;
+    double q2;
+    double q3;
+    double q4;
+    double q5;
+    double p0 = two_product(a.x[0], b.x[0], q0);
+    double p1 = two_product(a.x[0], b.x[1], q1);
+    double p2 = two_product(a.x[1], b.x[0], q2);
+    double p3 = two_product(a.x[0], b.x[2], q3);
+    double p4 = two_product(a.x[1], b.x[1], q4);
+    double p5 = two_product(a.x[2], b.x[0], q5);
+
+    three_sum(p1, p2, q0);
+    three_sum(p2, q1, q2);
+    three_sum(p3, p4, p5);
+
+    double t0;
+    double t1;
+    double s0 = two_sum(p2, p3, t0);
+    double s1 = two_sum(q1, p4, t1);
+    double s2 = q2 + p5;
+    s1 = two_sum(s1, t0, t0);
+    s2 += t0 + t1;
+    s1 += a.x[0] * b.x[3] + a.x[1] * b.x[2] + a.x[2] * b.x[1] + a.x[3] * b.x[0] + q0 + q3 + q4 + q5;
+    return renormalize(p0, p1, s0, s1, s2);
+}
+
+template <int N>
+MultiDouble<N> operator-(const MultiDouble<N>& a, const MultiDouble<N>& b) {
+    return a + -b;
+}
@@ -0,0 +1,296 @@
+#include "orbit_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <system_error>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// The header is followed by c_x, c_y, z_x and z_y, each as its sign, its limb count and its limbs, and then, at the
+// next multiple of 16 bytes, by point_count orbit points
+struct OrbitFileHeader {
+    char magic[8];
+    // byte_order_mark as the writer stores it
+    uint32_t byte_order;
+    int32_t max_iterations;
+    uint64_t point_count;
+    uint32_t number_words;
+    uint32_t reserved;
+};
+
+constexpr char orbit_file_magic[8] = {'M', 'B', 'O', 'R', 'B', 'I', 'T', '1'};
+constexpr uint32_t byte_order_mark = 0x01020304;
+constexpr const char* orbit_file_extension = ".orbit";
+
+size_t points_offset(uint32_t number_words) {
+    size_t end = sizeof(OrbitFileHeader) + 4 * static_cast<size_t>(number_words);
+    return (end + 15) / 16 * 16;
+}
+
+void append_number(const BigFixed& number, std::vector<uint32_t>& words) {
+    const std::vector<uint32_t>& limbs = number.raw_limbs();
+    words.push_back(number.is_negative() ? 1 : 0);
+    words.push_back(static_cast<uint32_t>(limbs.size()));
+    words.insert(words.end(), limbs.begin(), limbs.end());
+}
+
+// Reads the number at words[pos], returns false if it runs past end
+bool read_number(const uint32_t* words, size_t end, size_t& pos, BigFixed& number) {
+    if (pos + 2 > end) {
+        return false;
+    }
+    bool negative = words[pos] != 0;
+    size_t count = words[pos + 1];
+    pos += 2;
+    if (count == 0 || pos + count > end) {
+        return false;
+    }
+    number = BigFixed::from_raw_limbs(words + pos, static_cast<int>(count), negative);
+    pos += count;
+    return true;
+}
+
+bool same_number(const BigFixed& a, const BigFixed& b) {
+    return a.is_negative() == b.is_negative() && a.raw_limbs() == b.raw_limbs();
+}
+
+// FNV-1a over the signs and limbs of the reference point, so every precision of a point gets its own file
+std::string file_name(const BigFixed& c_x, const BigFixed& c_y) {
+    std::vector<uint32_t> words;
+    append_number(c_x, words);
+    append_number(c_y, words);
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint32_t word : words) {
+        for (int byte = 0; byte < 4; byte++) {
+            hash ^= (word >> (8 * byte)) & 0xff;
+            hash *= 0x100000001b3ull;
+        }
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    return name + std::string(orbit_file_extension);
+}
+
+// Maps the whole file read-only, the mapping is released with the last copy of the pointer
+std::shared_ptr<const void> map_file(const std::string& path, size_t& size) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    LARGE_INTEGER file_size;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        return nullptr;
+    }
+    // The view keeps the file mapped after both handles are closed
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == nullptr) {
+        return nullptr;
+    }
+    size = static_cast<size_t>(file_size.QuadPart);
+    return std::shared_ptr<const void>(view, [](void* view) { UnmapViewOfFile(view); });
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return nullptr;
+    }
+    struct stat info;
+    void* view = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0) {
+        view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    close(file);
+    if (view == MAP_FAILED) {
+        return nullptr;
+    }
+    size = static_cast<size_t>(info.st_size);
+    size_t length = size;
+    return std::shared_ptr<const void>(view, [length](void* view) { munmap(view, length); });
+#endif
+}
+
+}  // namespace
+
+OrbitCache::OrbitCache(const std::string& directory, uint64_t max_bytes) : directory(directory), max_bytes(max_bytes) {
+    std::error_code error;
+    fs::create_directories(directory, error);
+}
+
+ReferenceOrbit OrbitCache::get(const BigFixed& c_x, const BigFixed& c_y, int max_iterations) {
+    std::string path = (fs::path(directory) / file_name(c_x, c_y)).string();
+    ReferenceOrbit orbit;
+    BigFixed z_x;
+    BigFixed z_y;
+    if (load(path, c_x, c_y, orbit, z_x, z_y)) {
+        // The modification time is the last use for eviction
+        std::error_code error;
+        fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+        if (orbit.escaped() || max_iterations <= orbit.max_iterations) {
+            orbit.points.truncate(max_iterations + 2);
+            orbit.max_iterations = max_iterations;
+            cache_stats.loaded++;
+            return orbit;
+        }
+        cache_stats.extended++;
+    } else {
+        orbit = ReferenceOrbit();
+        orbit.c_x = c_x;
+        orbit.c_y = c_y;
+        orbit.points.push_back({0.0, 0.0});
+        int fraction_limbs = std::max(c_x.fraction_limbs(), c_y.fraction_limbs());
+        z_x = BigFixed(0.0, fraction_limbs);
+        z_y = BigFixed(0.0, fraction_limbs);
+        cache_stats.computed++;
+    }
+
+    extend_reference_orbit(orbit, z_x, z_y, max_iterations);
+    store(path, orbit, z_x, z_y);
+    evict(path);
+    return orbit;
+}
+
+bool OrbitCache::load(const std::string& path, const BigFixed& c_x, const BigFixed& c_y, ReferenceOrbit& orbit,
+                      BigFixed& z_x, BigFixed& z_y) const {
+    size_t size = 0;
+    std::shared_ptr<const void> mapping = map_file(path, size);
+    if (!mapping || size < sizeof(OrbitFileHeader)) {
+        return false;
+    }
+    const char* bytes = static_cast<const char*>(mapping.get());
+    OrbitFileHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, orbit_file_magic, sizeof(header.magic)) != 0 ||
+        header.byte_order != byte_order_mark || header.max_iterations < 0 || header.point_count == 0) {
+        return false;
+    }
+    size_t offset = points_offset(header.number_words);
+    if (offset > size || (size - offset) / sizeof(OrbitPoint) < header.point_count) {
+        return false;
+    }
+
+    // The numbers start right after the 32-byte header, so they are aligned for reading in place
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(bytes + sizeof(OrbitFileHeader));
+    size_t pos = 0;
+    BigFixed stored_x;
+    BigFixed stored_y;
+    size_t end = header.number_words;
+    if (!read_number(words, end, pos, stored_x) || !read_number(words, end, pos, stored_y) ||
+        !read_number(words, end, pos, z_x) || !read_number(words, end, pos, z_y)) {
+        return false;
+    }
+    // Files are named after a hash, two points may share one
+    if (!same_number(stored_x, c_x) || !same_number(stored_y, c_y)) {
+        return false;
+    }
+
+    orbit.c_x = c_x;
+    orbit.c_y = c_y;
+    orbit.max_iterations = header.max_iterations;
+    const OrbitPoint* points = reinterpret_cast<const OrbitPoint*>(bytes + offset);
+    orbit.points.assign_mapped(std::move(mapping), points, static_cast<size_t>(header.point_count));
+    return true;
+}
+
+void OrbitCache::store(const std::string& path, const ReferenceOrbit& orbit, const BigFixed& z_x,
+                       const BigFixed& z_y) {
+    std::vector<uint32_t> words;
+    append_number(orbit.c_x, words);
+    append_number(orbit.c_y, words);
+    append_number(z_x, words);
+    append_number(z_y, words);
+
+    OrbitFileHeader header = {};
+    std::memcpy(header.magic, orbit_file_magic, sizeof(header.magic));
+    header.byte_order = byte_order_mark;
+    header.max_iterations = orbit.max_iterations;
+    header.point_count = orbit.points.size();
+    header.number_words = static_cast<uint32_t>(words.size());
+    size_t padding = points_offset(header.number_words) - sizeof(header) - 4 * words.size();
+
+    std::string temporary = path + "." + std::to_string(std::random_device()()) + ".tmp";
+    bool written;
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(words.data()), 4 * words.size());
+        file.write("\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", padding);
+        file.write(reinterpret_cast<const char*>(orbit.points.data()), sizeof(OrbitPoint) * orbit.points.size());
+        written = static_cast<bool>(file);
+    }
+    std::error_code error;
+    if (written) {
+        // Replacing a file another process has mapped fails on Windows, the old orbit stays then
+        fs::rename(temporary, path, error);
+    } else {
+        cache_stats.failed_writes++;
+    }
+    if (!written || error) {
+        fs::remove(temporary, error);
+    }
+}
+
+void OrbitCache::evict(const std::string& keep) {
+    struct CacheFile {
+        fs::file_time_type last_use;
+        uint64_t size;
+        fs::path path;
+    };
+    std::vector<CacheFile> files;
+    uint64_t total = 0;
+    std::error_code error;
+    for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if (it->path().extension() != orbit_file_extension) {
+            continue;
+        }
+        std::error_code file_error;
+        CacheFile file = {it->last_write_time(file_error), it->file_size(file_error), it->path()};
+        if (!file_error) {
+            files.push_back(file);
+            total += file.size;
+        }
+    }
+    if (total <= max_bytes) {
+        return;
+    }
+
+    std::sort(files.begin(), files.end(),
+              [](const CacheFile& a, const CacheFile& b) { return a.last_use < b.last_use; });
+    for (const CacheFile& file : files) {
+        if (total <= max_bytes) {
+            break;
+        }
+        if (file.path == fs::path(keep)) {
+            continue;
+        }
+        std::error_code remove_error;
+        if (fs::remove(file.path, remove_error)) {
+            total -= file.size;
+            cache_stats.evicted++;
+        }
+    }
+}
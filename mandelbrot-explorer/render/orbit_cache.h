@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "big_fixed.h"
+#include "perturbation.h"
+
+// What the orbit cache did since it was created
+struct OrbitCacheStats {
+    // Stored orbits that were long enough, stored orbits that had to be continued, and orbits computed from scratch
+    int loaded = 0;
+    int extended = 0;
+    int computed = 0;
+    // Files removed to stay below the size limit, and orbits that could not be written
+    int evicted = 0;
+    int failed_writes = 0;
+};
+
+// Reference orbits stored on disk, so reruns and the neighbouring frames of a zoom sequence do not compute the same
+// orbit again. Every orbit is one file, named after a hash of its reference point at its exact precision, that holds
+// the point, the full-precision last Z and the rounded orbit points. Stored orbits are memory-mapped instead of
+// read, a longer one serves shorter requests as well, and a shorter one is continued from its last Z. Files are
+// native byte order, ones written on a machine of the other byte order count as missing.
+// The least recently used files are removed once the directory grows past max_bytes.
+class OrbitCache {
+   public:
+    static constexpr uint64_t default_max_bytes = 1ull << 30;
+
+    // Creates directory if it does not exist yet
+    explicit OrbitCache(const std::string& directory, uint64_t max_bytes = default_max_bytes);
+
+    // Same orbit as compute_reference_orbit(c_x, c_y, max_iterations), from the cache when possible. New and
+    // extended orbits are written back.
+    ReferenceOrbit get(const BigFixed& c_x, const BigFixed& c_y, int max_iterations);
+
+    const OrbitCacheStats& stats() const { return cache_stats; }
+
+   private:
+    // Maps the orbit in path if it belongs to (c_x, c_y), with the full-precision value of its last point
+    bool load(const std::string& path, const BigFixed& c_x, const BigFixed& c_y, ReferenceOrbit& orbit,
+              BigFixed& z_x, BigFixed& z_y) const;
+
+    // Writes through a temporary file, so other processes never map a half-written orbit
+    void store(const std::string& path, const ReferenceOrbit& orbit, const BigFixed& z_x, const BigFixed& z_y);
+
+    // Removes the least recently used files other than keep until the directory fits max_bytes
+    void evict(const std::string& keep);
+
+    std::string directory;
+    uint64_t max_bytes;
+    OrbitCacheStats cache_stats;
+};
@@ -0,0 +1,46 @@
+#include "palette.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+float fract(float x) { return x - std::floor(x); }
+
+float clamp01(float x) { return std::min(std::max(x, 0.0f), 1.0f); }
+
+// GLSL mix() as defined by the spec: x * (1 - a) + y * a
+float mix(float x, float y, float a) { return x * (1.0f - a) + y * a; }
+
+// Float to normalized unsigned byte, the conversion GL applies when writing to an RGBA8 framebuffer
+uint32_t to_unorm8(float x) { return static_cast<uint32_t>(clamp01(x) * 255.0f + 0.5f); }
+
+uint32_t pack_rgba(float r, float g, float b, float a) {
+    return to_unorm8(r) | (to_unorm8(g) << 8) | (to_unorm8(b) << 16) | (to_unorm8(a) << 24);
+}
+
+}  // namespace
+
+void hsv2rgb(const float hsv[3], float rgb[3]) {
+    const float K[4] = {1.0f, 2.0f / 3.0f, 1.0f / 3.0f, 3.0f};
+    for (int channel = 0; channel < 3; channel++) {
+        float p = std::abs(fract(hsv[0] + K[channel]) * 6.0f - K[3]);
+        rgb[channel] = hsv[2] * mix(K[0], clamp01(p - K[0]), hsv[1]);
+    }
+}
+
+std::vector<uint32_t> build_palette(int max_iterations) {
+    std::vector<uint32_t> palette(max_iterations + 1);
+    int cuttoff = std::min(max_iterations / 2, 50);
+    for (int i = 0; i < max_iterations; i++) {
+        float col = static_cast<float>(i) / static_cast<float>(max_iterations);
+        float value = i < cuttoff ? static_cast<float>(i) / static_cast<float>(cuttoff) : 1.0f;
+        float hsv[3] = {col, 1.0f, value};
+        float rgb[3];
+        hsv2rgb(hsv, rgb);
+        palette[i] = pack_rgba(rgb[0], rgb[1], rgb[2], 1.0f);
+    }
+    float white_shade = 0.9f;
+    palette[max_iterations] = pack_rgba(white_shade, white_shade, white_shade, white_shade);
+    return palette;
+}
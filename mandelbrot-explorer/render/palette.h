@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// RGBA8 color (red in the lowest byte) for every iteration count in [0, max_iterations], computed exactly like the
+// coloring at the end of main() in shaders/fragmentShader.glsl.
+std::vector<uint32_t> build_palette(int max_iterations);
+
+// GLSL hsv2rgb, all components are in the range [0…1]
+void hsv2rgb(const float hsv[3], float rgb[3]);
@@ -0,0 +1,395 @@
+#include "perturbation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#include "bla.h"
+#include "cpu_renderer.h"
+
+namespace {
+
+// View offset of the center of pixel (x, row) from the view center
+FloatExp pixel_offset_x(const RenderParams& params, int x) {
+    double coord_x = 2.0 * (x + 0.5) / params.width - 1.0;
+    return coord_x / params.zoom;
+}
+
+FloatExp pixel_offset_y(const RenderParams& params, int row) {
+    double coord_y = 1.0 - 2.0 * (row + 0.5) / params.height;
+    return coord_y / params.aspectRatio / params.zoom;
+}
+
+// Offsets are iterated as FloatExp until they reach 2^-900. From there on, doubles hold them, and dc, which is
+// rounded to a denormal or 0 in the deepest views, is too small next to them to matter.
+constexpr int64_t float_exp_offset_exponent = -900;
+
+bool leaves_float_exp(double, double) { return false; }
+
+bool leaves_float_exp(const FloatExp& dx, const FloatExp& dy) {
+    return std::max(dx.exponent(), dy.exponent()) >= float_exp_offset_exponent;
+}
+
+double to_double(double value) { return value; }
+
+double to_double(const FloatExp& value) { return value.to_double(); }
+
+// Finishes a pixel that still follows the reference closely when the reference escapes. The pixel is about to
+// escape as well, and plain double precision is good enough for its last iterations.
+int iterate_plain(double zx, double zy, double cx, double cy, int first_iteration, int max_iterations) {
+    for (int i = first_iteration; i < max_iterations; i++) {
+        double xtemp = zx * zx - zy * zy + cx;
+        zy = 2.0 * zx * zy + cy;
+        zx = xtemp;
+        if (zx * zx + zy * zy > 4.0) {
+            return i;
+        }
+    }
+    return max_iterations;
+}
+
+// Iterates the offset dz_n = z_n - Z_n of a pixel at C + dc, from dz_n = (dx, dy) at iteration i:
+// dz_{n+1} = 2 Z_n dz_n + dz_n² + dc = (2 Z_n + dz_n) dz_n + dc
+// Sets glitched and stops when the offset loses its precision, or when the reference escapes while the pixel has
+// already moved away from it. With a BLA table, the first iterations are skipped in runs for as long as the table has
+// a step that holds. Once the offset has outgrown it, it rarely fits again, so the rest is iterated one by one.
+// Real is double, or FloatExp for offsets below the range of a double. FloatExp hands over by returning -1 as soon
+// as doubles can take the offset, with (dx, dy), n and i left where the double iteration has to continue.
+template <typename Real>
+int iterate_offset(const ReferenceOrbit& orbit, const BlaTable* bla, double c_x, double c_y, const Real& dc_x,
+                   const Real& dc_y, int max_iterations, Real& start_dx, Real& start_dy, int& start_n, int& start_i,
+                   bool& glitched, uint64_t& skipped) {
+    const OrbitPoint* z = orbit.points.data();
+    int last = static_cast<int>(orbit.points.size()) - 1;
+
+    // Locals stay in registers
+    Real dx = start_dx;
+    Real dy = start_dy;
+    int n = start_n;
+    int i = start_i;
+    bool approximating = bla != nullptr;
+    while (i < max_iterations) {
+        if (leaves_float_exp(dx, dy)) {
+            start_dx = dx;
+            start_dy = dy;
+            start_n = n;
+            start_i = i;
+            return -1;
+        }
+        if (n == last) {
+            if (dx * dx + dy * dy < glitch_tolerance * (z[n].x * z[n].x + z[n].y * z[n].y)) {
+                return iterate_plain(z[n].x + to_double(dx), z[n].y + to_double(dy), c_x + to_double(dc_x),
+                                     c_y + to_double(dc_y), i, max_iterations);
+            }
+            glitched = true;
+            return i;
+        }
+
+        int length = 1;
+        int step_skipped = 0;
+        const BlaStep* step = approximating ? bla->find(n, dx * dx + dy * dy, max_iterations - i, length) : nullptr;
+        if (step) {
+            Real next_dx = step->a_x * dx - step->a_y * dy + step->b_x * dc_x - step->b_y * dc_y;
+            dy = step->a_x * dy + step->a_y * dx + step->b_x * dc_y + step->b_y * dc_x;
+            dx = next_dx;
+            step_skipped = length;
+        } else {
+            approximating = false;
+            Real tx = 2.0 * z[n].x + dx;
+            Real ty = 2.0 * z[n].y + dy;
+            Real next_dx = tx * dx - ty * dy + dc_x;
+            dy = tx * dy + ty * dx + dc_y;
+            dx = next_dx;
+        }
+        n += length;
+        i += length;
+
+        Real px = z[n].x + dx;
+        Real py = z[n].y + dy;
+        Real radius_squared = px * px + py * py;
+        bool escaped = radius_squared > 4.0;
+        if (escaped || radius_squared < glitch_tolerance * (z[n].x * z[n].x + z[n].y * z[n].y)) {
+            if (!escaped) {
+                glitched = true;
+            }
+            // The count of the pixel stops one short of i, and so do the iterations the step skipped
+            skipped += std::max(step_skipped - 1, 0);
+            return i - 1;
+        }
+        skipped += step_skipped;
+    }
+    return max_iterations;
+}
+
+}  // namespace
+
+void OrbitPoints::assign_mapped(std::shared_ptr<const void> mapping, const OrbitPoint* first, size_t count) {
+    owned.clear();
+    this->mapping = std::move(mapping);
+    mapped_points = first;
+    mapped_count = count;
+}
+
+void OrbitPoints::push_back(const OrbitPoint& point) {
+    if (mapping) {
+        owned.assign(begin(), end());
+        mapping.reset();
+    }
+    owned.push_back(point);
+}
+
+void OrbitPoints::truncate(size_t count) {
+    if (mapping) {
+        mapped_count = std::min(mapped_count, count);
+    } else if (count < owned.size()) {
+        owned.resize(count);
+    }
+}
+
+ReferenceOrbit compute_reference_orbit(const BigFixed& c_x, const BigFixed& c_y, int max_iterations, unsigned threads) {
+    ReferenceOrbit orbit;
+    orbit.c_x = c_x;
+    orbit.c_y = c_y;
+    orbit.points.push_back({0.0, 0.0});
+
+    int fraction_limbs = std::max(c_x.fraction_limbs(), c_y.fraction_limbs());
+    BigFixed z_x(0.0, fraction_limbs);
+    BigFixed z_y(0.0, fraction_limbs);
+    extend_reference_orbit(orbit, z_x, z_y, max_iterations, threads);
+    return orbit;
+}
+
+void extend_reference_orbit(ReferenceOrbit& orbit, BigFixed& z_x, BigFixed& z_y, int max_iterations,
+                            unsigned threads) {
+    const BigFixed& c_x = orbit.c_x;
+    const BigFixed& c_y = orbit.c_y;
+    OrbitPoint last = orbit.points.back();
+    bool escaped = last.x * last.x + last.y * last.y > 4.0;
+    orbit.max_iterations = max_iterations;
+    int first_step = static_cast<int>(orbit.points.size()) - 1;
+    if (escaped || first_step > max_iterations) {
+        return;
+    }
+    orbit.points.reserve(max_iterations + 2);
+
+    int fraction_limbs = std::max(c_x.fraction_limbs(), c_y.fraction_limbs());
+    if (threads == 0) {
+        threads = fraction_limbs >= parallel_orbit_limbs ? std::thread::hardware_concurrency() : 1;
+    }
+    threads = std::max(1u, std::min(threads, 3u));
+
+    // Z² = x² - y² + 2xy i, product k is computed by thread k % threads
+    BigFixed products[3];
+    auto compute_product = [&](int k) {
+        if (k == 0) {
+            BigFixed::square(z_x, products[0]);
+        } else if (k == 1) {
+            BigFixed::square(z_y, products[1]);
+        } else {
+            BigFixed::multiply(z_x, z_y, products[2]);
+        }
+    };
+
+    // A step takes microseconds, far too short to wake threads through a condition variable. The helpers spin on the
+    // step counter instead, and yield in case they share a core with the thread they wait for.
+    std::atomic<int> started_steps{0};
+    std::atomic<int> finished_products{0};
+    std::atomic<bool> stopping{false};
+    auto wait_for = [](const std::atomic<int>& counter, int value) {
+        for (int spins = 0; counter.load(std::memory_order_acquire) < value; spins++) {
+            if (spins > 1000) {
+                std::this_thread::yield();
+            }
+        }
+    };
+    // The calling thread computes products 0, threads, ..., the helpers the rest
+    int helper_products = 3 - (2 + static_cast<int>(threads)) / static_cast<int>(threads);
+    std::vector<std::thread> helpers;
+    for (unsigned id = 1; id < threads; id++) {
+        helpers.emplace_back([&, id] {
+            for (int step = 1;; step++) {
+                wait_for(started_steps, step);
+                if (stopping.load(std::memory_order_acquire)) {
+                    return;
+                }
+                for (int k = static_cast<int>(id); k < 3; k += static_cast<int>(threads)) {
+                    compute_product(k);
+                    finished_products.fetch_add(1, std::memory_order_release);
+                }
+            }
+        });
+    }
+
+    int step = 0;
+    for (int n = first_step; n <= max_iterations; n++) {
+        started_steps.store(++step, std::memory_order_release);
+        for (int k = 0; k < 3; k += static_cast<int>(threads)) {
+            compute_product(k);
+        }
+        wait_for(finished_products, step * helper_products);
+
+        z_x = products[0];
+        z_x -= products[1];
+        z_x += c_x;
+        z_y = products[2];
+        z_y += products[2];
+        z_y += c_y;
+
+        OrbitPoint point = {z_x.to_double(), z_y.to_double()};
+        orbit.points.push_back(point);
+        if (point.x * point.x + point.y * point.y > 4.0) {
+            break;
+        }
+    }
+
+    stopping.store(true, std::memory_order_release);
+    started_steps.store(step + 1, std::memory_order_release);
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+}
+
+int reference_fraction_limbs(const FloatExp& zoom, int width) {
+    // The view is 2 / zoom wide, so a pixel is 2 / (zoom * width)
+    double pixel_bits = std::max((zoom * (width / 2.0)).log2(), 0.0);
+    return static_cast<int>(std::ceil(pixel_bits / 32.0)) + 1;
+}
+
+uint64_t render_perturbation_tile(const RenderParams& params, const ReferenceOrbit& orbit, const BlaTable* bla,
+                                  const Tile& tile, const PassGrid& grid, bool only_glitched, uint32_t* iterations,
+                                  uint8_t* glitched, uint64_t& skipped) {
+    // Offset of the view center from the reference, which only fits in a double down to about 1e-300
+    FloatExp offset_x = (params.center_x - orbit.c_x).to_float_exp();
+    FloatExp offset_y = (params.center_y - orbit.c_y).to_float_exp();
+    double c_x = orbit.c_x.to_double();
+    double c_y = orbit.c_y.to_double();
+
+    // Shallower views never touch FloatExp in the iteration
+    FloatExp pixel_spacing = 2.0 / (params.zoom * params.width);
+    bool deep = pixel_spacing.exponent() < float_exp_offset_exponent;
+
+    uint64_t tile_iterations = 0;
+    for (int row = tile.y0; row < tile.y1; row++) {
+        if (!grid.covers_row(row)) continue;
+        FloatExp dc_y = pixel_offset_y(params, row) + offset_y;
+        size_t row_start = static_cast<size_t>(row) * params.width;
+        for (int x = grid.first_column(row, tile.x0); x < tile.x1; x += grid.column_step(row)) {
+            if (only_glitched && !glitched[row_start + x]) {
+                continue;
+            }
+            FloatExp dc_x = pixel_offset_x(params, x) + offset_x;
+            bool pixel_glitched = false;
+            int n = 1;
+            int i = 0;
+            int count = -1;
+            if (deep) {
+                // The shaders start from z = c = Z_1 + dc
+                FloatExp dx = dc_x;
+                FloatExp dy = dc_y;
+                count = iterate_offset(orbit, bla, c_x, c_y, dc_x, dc_y, params.max_iterations, dx, dy, n, i,
+                                       pixel_glitched, skipped);
+                if (count < 0) {
+                    double double_dx = dx.to_double();
+                    double double_dy = dy.to_double();
+                    count = iterate_offset(orbit, bla, c_x, c_y, dc_x.to_double(), dc_y.to_double(),
+                                           params.max_iterations, double_dx, double_dy, n, i, pixel_glitched, skipped);
+                }
+            } else {
+                double double_dc_x = dc_x.to_double();
+                double double_dc_y = dc_y.to_double();
+                double dx = double_dc_x;
+                double dy = double_dc_y;
+                count = iterate_offset(orbit, bla, c_x, c_y, double_dc_x, double_dc_y, params.max_iterations, dx, dy,
+                                       n, i, pixel_glitched, skipped);
+            }
+            iterations[row_start + x] = static_cast<uint32_t>(count);
+            glitched[row_start + x] = pixel_glitched;
+            tile_iterations += count;
+        }
+    }
+    return tile_iterations;
+}
+
+FloatExp max_pixel_offset(const RenderParams& params, const ReferenceOrbit& orbit) {
+    FloatExp offset_x = (params.center_x - orbit.c_x).to_float_exp();
+    FloatExp offset_y = (params.center_y - orbit.c_y).to_float_exp();
+    FloatExp half_diagonal = std::hypot(1.0, 1.0 / params.aspectRatio) / params.zoom;
+    return sqrt(offset_x * offset_x + offset_y * offset_y) + half_diagonal;
+}
+
+bool find_glitch_reference(const uint8_t* glitched, const uint32_t* iterations, int width, int height, int& x,
+                           int& y) {
+    size_t pixel_count = static_cast<size_t>(width) * height;
+    std::vector<uint8_t> visited(pixel_count, 0);
+    std::vector<size_t> cluster;
+    std::vector<size_t> largest;
+
+    for (size_t seed = 0; seed < pixel_count; seed++) {
+        if (!glitched[seed] || visited[seed]) {
+            continue;
+        }
+
+        // Flood fill, cluster doubles as the stack of pixels still to expand
+        cluster.assign(1, seed);
+        visited[seed] = 1;
+        for (size_t next = 0; next < cluster.size(); next++) {
+            int px = static_cast<int>(cluster[next] % width);
+            int py = static_cast<int>(cluster[next] / width);
+            const int neighbours[4][2] = {{px - 1, py}, {px + 1, py}, {px, py - 1}, {px, py + 1}};
+            for (const auto& neighbour : neighbours) {
+                if (neighbour[0] < 0 || neighbour[0] >= width || neighbour[1] < 0 || neighbour[1] >= height) {
+                    continue;
+                }
+                size_t index = static_cast<size_t>(neighbour[1]) * width + neighbour[0];
+                if (glitched[index] && !visited[index]) {
+                    visited[index] = 1;
+                    cluster.push_back(index);
+                }
+            }
+        }
+        if (cluster.size() > largest.size()) {
+            largest.swap(cluster);
+        }
+    }
+    if (largest.empty()) {
+        return false;
+    }
+
+    // A reference that lasts longer takes more of the cluster further
+    uint32_t furthest = 0;
+    double sum_x = 0.0;
+    double sum_y = 0.0;
+    for (size_t index : largest) {
+        furthest = std::max(furthest, iterations[index]);
+        sum_x += static_cast<double>(index % width);
+        sum_y += static_cast<double>(index / width);
+    }
+    double centroid_x = sum_x / largest.size();
+    double centroid_y = sum_y / largest.size();
+
+    // The centroid of a curved cluster can lie outside of it
+    double best_distance = -1.0;
+    for (size_t index : largest) {
+        if (iterations[index] != furthest) {
+            continue;
+        }
+        double dx = static_cast<double>(index % width) - centroid_x;
+        double dy = static_cast<double>(index / width) - centroid_y;
+        double distance = dx * dx + dy * dy;
+        if (best_distance < 0.0 || distance < best_distance) {
+            best_distance = distance;
+            x = static_cast<int>(index % width);
+            y = static_cast<int>(index / width);
+        }
+    }
+    return true;
+}
+
+void pixel_position(const RenderParams& params, int x, int y, BigFixed& c_x, BigFixed& c_y) {
+    int fraction_limbs = reference_fraction_limbs(params.zoom, params.width);
+    c_x = params.center_x + BigFixed(pixel_offset_x(params, x), fraction_limbs);
+    c_y = params.center_y + BigFixed(pixel_offset_y(params, y), fraction_limbs);
+    c_x.set_fraction_limbs(fraction_limbs);
+    c_y.set_fraction_limbs(fraction_limbs);
+}
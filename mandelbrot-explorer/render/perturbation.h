@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "big_fixed.h"
+#include "float_exp.h"
+#include "tile.h"
+
+struct RenderParams;
+class BlaTable;
+
+struct OrbitPoint {
+    double x, y;
+};
+
+// Points of a reference orbit, held in memory or read straight from a memory-mapped orbit cache file, which stays
+// mapped for as long as an orbit uses it
+class OrbitPoints {
+   public:
+    size_t size() const { return mapping ? mapped_count : owned.size(); }
+    const OrbitPoint* data() const { return mapping ? mapped_points : owned.data(); }
+    const OrbitPoint& operator[](size_t i) const { return data()[i]; }
+    const OrbitPoint& back() const { return data()[size() - 1]; }
+    const OrbitPoint* begin() const { return data(); }
+    const OrbitPoint* end() const { return data() + size(); }
+
+    bool is_mapped() const { return mapping != nullptr; }
+
+    // Takes count points starting at first, which lie inside mapping
+    void assign_mapped(std::shared_ptr<const void> mapping, const OrbitPoint* first, size_t count);
+
+    void reserve(size_t count) { owned.reserve(count); }
+
+    // Mapped points are copied into memory first
+    void push_back(const OrbitPoint& point);
+
+    // Keeps the first count points
+    void truncate(size_t count);
+
+   private:
+    std::vector<OrbitPoint> owned;
+    std::shared_ptr<const void> mapping;
+    const OrbitPoint* mapped_points = nullptr;
+    size_t mapped_count = 0;
+};
+
+// Orbit Z_0 = 0, Z_{n+1} = Z_n² + C of the reference point C, iterated in full precision and rounded to double
+// after every step. Pixels near C are iterated as the small offset of their orbit from this one.
+struct ReferenceOrbit {
+    BigFixed c_x;
+    BigFixed c_y;
+    int max_iterations = 0;
+    // Ends at the first point with |Z|² > 4, or at Z_{max_iterations + 1} when C does not escape
+    OrbitPoints points;
+
+    bool escaped() const { return static_cast<int>(points.size()) < max_iterations + 2; }
+
+    // Iteration count the shaders give C itself
+    int escape_iteration() const {
+        return escaped() ? std::max(static_cast<int>(points.size()) - 3, 0) : max_iterations;
+    }
+};
+
+// Reference points with at least this many fractional limbs compute x², y² and xy of every step on three threads
+constexpr int parallel_orbit_limbs = 64;
+
+// threads == 0 picks up to three threads from the precision of C and the hardware, 1 is serial
+ReferenceOrbit compute_reference_orbit(const BigFixed& c_x, const BigFixed& c_y, int max_iterations,
+                                       unsigned threads = 0);
+
+// Continues orbit from its last point, whose full-precision value is (z_x, z_y), until it escapes or reaches
+// max_iterations, and leaves (z_x, z_y) at the new last point. An orbit that already escaped stays as it is, one
+// computed to more iterations must be truncated first.
+void extend_reference_orbit(ReferenceOrbit& orbit, BigFixed& z_x, BigFixed& z_y, int max_iterations,
+                            unsigned threads = 0);
+
+// Fractional limbs the reference point needs to resolve the pixels of a width pixels wide view at zoom, with
+// 32 bits to spare for the rounding of the orbit
+int reference_fraction_limbs(const FloatExp& zoom, int width);
+
+// Pauldelbrot's criterion: once |Z + dz|² drops below this fraction of |Z|², the offset dz has lost the precision
+// the pixel needs and the pixel is glitched
+constexpr double glitch_tolerance = 1e-6;
+
+// What the glitch correction of a perturbation frame cost
+struct PerturbationStats {
+    int references = 0;
+    int rerender_passes = 0;
+    // Glitched after the first pass, and still glitched when the reference limit was reached
+    long long glitched_pixels = 0;
+    long long unresolved_pixels = 0;
+    // Iterations of all passes, and how many of them bilinear approximation skipped
+    uint64_t iterations = 0;
+    uint64_t skipped_iterations = 0;
+};
+
+// Iterates the pixels of one tile of the view centered on (params.center_x, params.center_y) as double offsets from
+// the reference orbit, writing into the full-frame iterations buffer. The iteration counts have the same meaning as
+// in the shaders, the reference may lie anywhere near the view. Pixel offsets below the range of a double, past a
+// zoom of about 1e270, start out as FloatExp and continue in doubles once they have grown large enough.
+// Pixels that glitch, or outlive the reference orbit, are flagged in the full-frame glitched buffer instead. Only the
+// pixels grid takes are iterated, and with only_glitched set just the flagged ones among them. bla may be nullptr,
+// otherwise the iterations it skips are added to skipped. Returns the number of iterations of the tile's pixels,
+// skipped ones included.
+uint64_t render_perturbation_tile(const RenderParams& params, const ReferenceOrbit& orbit, const BlaTable* bla,
+                                  const Tile& tile, const PassGrid& grid, bool only_glitched, uint32_t* iterations,
+                                  uint8_t* glitched, uint64_t& skipped);
+
+// Largest |dc| of a pixel of the view relative to the reference
+FloatExp max_pixel_offset(const RenderParams& params, const ReferenceOrbit& orbit);
+
+// Picks a new reference inside the largest 4-connected cluster of glitched pixels: the pixel that got furthest before
+// it glitched, and of those the one closest to the cluster's centroid. Returns false if no pixel is glitched.
+bool find_glitch_reference(const uint8_t* glitched, const uint32_t* iterations, int width, int height, int& x, int& y);
+
+// Full-precision position of the center of pixel (x, y) in the view
+void pixel_position(const RenderParams& params, int x, int y, BigFixed& c_x, BigFixed& c_y);
@@ -0,0 +1,77 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 1; i < thread_count; i++) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run_on_all(const std::function<void(unsigned)>& task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current_task = &task;
+        busy_workers = static_cast<unsigned>(workers.size());
+        generation++;
+    }
+    start_cv.notify_all();
+
+    task(0);
+
+    // Workers still hold a pointer to task, so wait until every one of them has let go of it
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this] { return busy_workers == 0; });
+    current_task = nullptr;
+}
+
+void ThreadPool::parallel_for(int count, const std::function<void(int, unsigned)>& job) {
+    if (count <= 0) {
+        return;
+    }
+    std::atomic<int> next_index{0};
+    run_on_all([&](unsigned worker_id) {
+        for (int index = next_index.fetch_add(1); index < count; index = next_index.fetch_add(1)) {
+            job(index, worker_id);
+        }
+    });
+}
+
+void ThreadPool::worker_loop(unsigned worker_id) {
+    unsigned seen_generation = 0;
+    while (true) {
+        const std::function<void(unsigned)>* task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_cv.wait(lock, [&] { return stopping || generation != seen_generation; });
+            if (stopping) {
+                return;
+            }
+            seen_generation = generation;
+            task = current_task;
+        }
+
+        (*task)(worker_id);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy_workers--;
+        }
+        done_cv.notify_one();
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that repeatedly run parallel jobs.
+// The calling thread takes part in every job, so a pool of N threads keeps N cores busy.
+class ThreadPool {
+   public:
+    // thread_count == 0 sizes the pool to the number of hardware threads.
+    explicit ThreadPool(unsigned thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Runs task(worker_id) exactly once on every thread and blocks until all of them have returned.
+    // worker_id is in [0, size()), the calling thread is always worker 0.
+    void run_on_all(const std::function<void(unsigned)>& task);
+
+    // Runs job(index, worker_id) for every index in [0, count) and blocks until all have finished.
+    void parallel_for(int count, const std::function<void(int, unsigned)>& job);
+
+   private:
+    void worker_loop(unsigned worker_id);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+
+    const std::function<void(unsigned)>* current_task = nullptr;
+    unsigned generation = 0;
+    unsigned busy_workers = 0;
+    bool stopping = false;
+};
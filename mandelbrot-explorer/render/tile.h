@@ -0,0 +1,32 @@
+#pragma once
+
+// Rectangle of pixels [x0, x1) x [y0, y1), row 0 is the top of the image.
+struct Tile {
+    int x0, y0, x1, y1;
+
+    int width() const { return x1 - x0; }
+    int height() const { return y1 - y0; }
+    long long pixel_count() const { return static_cast<long long>(width()) * height(); }
+};
+
+// Pixels one pass of a progressive frame iterates. Every pass halves the spacing of the one before: a pass with
+// spacing s takes the pixels whose x and y are both multiples of s, except those the pass before, with spacing 2 s,
+// already iterated. The default is a single pass over every pixel.
+struct PassGrid {
+    int spacing = 1;
+    // The first pass has none before it and takes every pixel of its grid
+    bool first = true;
+
+    bool whole_frame() const { return spacing == 1 && first; }
+    bool covers_row(int y) const { return y % spacing == 0; }
+    bool covers_rows(int y0, int y1) const { return (y0 + spacing - 1) / spacing * spacing < y1; }
+
+    // Rows the pass before also covered only need the columns in between
+    int column_step(int y) const { return first || y % (2 * spacing) != 0 ? spacing : 2 * spacing; }
+    // First column of row y at or after x0 the pass takes
+    int first_column(int y, int x0) const {
+        int step = column_step(y);
+        int offset = step == spacing ? 0 : spacing;
+        return x0 + ((offset - x0) % step + step) % step;
+    }
+};
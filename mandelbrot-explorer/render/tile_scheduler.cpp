@@ -0,0 +1,107 @@
+#include "tile_scheduler.h"
+
+#include <chrono>
+#include <thread>
+
+TileScheduler::TileScheduler(ThreadPool& pool) : pool(pool) {
+    for (unsigned i = 0; i < pool.size(); i++) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+}
+
+void TileScheduler::run(const std::vector<Tile>& tiles, const RenderFunction& render) {
+    unsigned worker_count = pool.size();
+    worker_stats.assign(worker_count, WorkerStats());
+
+    // Contiguous bands keep neighbouring tiles, which tend to cost about the same, on one worker
+    for (size_t i = 0; i < tiles.size(); i++) {
+        unsigned owner = static_cast<unsigned>(i * worker_count / tiles.size());
+        queues[owner]->tiles.push_back(tiles[i]);
+    }
+    pending_tiles.store(static_cast<int>(tiles.size()));
+
+    pool.run_on_all([&](unsigned worker) { worker_loop(worker, render); });
+}
+
+void TileScheduler::worker_loop(unsigned worker, const RenderFunction& render) {
+    WorkerStats& stats = worker_stats[worker];
+    while (pending_tiles.load() > 0) {
+        Tile tile;
+        if (pop_own(worker, tile)) {
+            render_splitting(worker, tile, render);
+        } else if (steal(worker, tile)) {
+            stats.stolen_tiles++;
+            stats.stolen_pixels += tile.pixel_count();
+            render_splitting(worker, tile, render);
+        } else {
+            // Everything left is being rendered by others, but they may still split off more work
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool TileScheduler::pop_own(unsigned worker, Tile& tile) {
+    WorkerQueue& queue = *queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tiles.empty()) {
+        return false;
+    }
+    tile = queue.tiles.front();
+    queue.tiles.pop_front();
+    return true;
+}
+
+bool TileScheduler::steal(unsigned thief, Tile& tile) {
+    unsigned worker_count = static_cast<unsigned>(queues.size());
+    for (unsigned offset = 1; offset < worker_count; offset++) {
+        WorkerQueue& queue = *queues[(thief + offset) % worker_count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tiles.empty()) {
+            tile = queue.tiles.back();
+            queue.tiles.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void TileScheduler::render_splitting(unsigned worker, Tile tile, const RenderFunction& render) {
+    WorkerStats& stats = worker_stats[worker];
+    auto start = std::chrono::steady_clock::now();
+    stats.tiles++;
+    stats.pixels += tile.pixel_count();
+
+    while (tile.height() > 0) {
+        if (tile.height() < 4 * probe_rows) {
+            stats.iterations += render(tile);
+            break;
+        }
+
+        Tile probe = {tile.x0, tile.y0, tile.x1, tile.y0 + probe_rows};
+        uint64_t probe_iterations = render(probe);
+        stats.iterations += probe_iterations;
+        tile.y0 = probe.y1;
+
+        uint64_t estimate = probe_iterations * tile.height() / probe_rows;
+        if (estimate <= split_iterations) {
+            stats.iterations += render(tile);
+            break;
+        }
+
+        // Keep the top half, the bottom half becomes a tile of its own that another worker can steal
+        int middle = (tile.y0 + tile.y1) / 2;
+        Tile rest = {tile.x0, middle, tile.x1, tile.y1};
+        tile.y1 = middle;
+        stats.splits++;
+        stats.pixels -= rest.pixel_count();
+        pending_tiles.fetch_add(1);
+        {
+            WorkerQueue& queue = *queues[worker];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tiles.push_back(rest);
+        }
+    }
+
+    stats.busy_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    pending_tiles.fetch_sub(1);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "thread_pool.h"
+#include "tile.h"
+
+// What one worker did during the last TileScheduler::run
+struct WorkerStats {
+    int tiles = 0;
+    int stolen_tiles = 0;
+    int splits = 0;
+    long long pixels = 0;
+    long long stolen_pixels = 0;
+    uint64_t iterations = 0;
+    double busy_seconds = 0.0;
+};
+
+// Work-stealing tile scheduler. Every worker owns a deque that starts with a contiguous band of the frame's tiles.
+// A worker takes tiles from the front of its own deque and, once that is empty, steals from the back of another
+// worker's deque. Tiles are rendered a few rows at a time, and when the rows done so far predict that the rest is
+// expensive, the rest is split in half and one half goes to the back of the deque where idle workers can steal it.
+class TileScheduler {
+   public:
+    // Renders a tile and returns the number of iterations it took
+    using RenderFunction = std::function<uint64_t(const Tile&)>;
+
+    explicit TileScheduler(ThreadPool& pool);
+
+    void run(const std::vector<Tile>& tiles, const RenderFunction& render);
+
+    // Per worker statistics of the last run
+    const std::vector<WorkerStats>& stats() const { return worker_stats; }
+
+    // The rest of a tile is split when it is estimated to need more than this many iterations
+    void set_split_threshold(uint64_t iterations) { split_iterations = iterations; }
+
+   private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Tile> tiles;
+    };
+
+    void worker_loop(unsigned worker, const RenderFunction& render);
+    bool pop_own(unsigned worker, Tile& tile);
+    bool steal(unsigned thief, Tile& tile);
+    void render_splitting(unsigned worker, Tile tile, const RenderFunction& render);
+
+    static constexpr int probe_rows = 4;
+
+    ThreadPool& pool;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<WorkerStats> worker_stats;
+    std::atomic<int> pending_tiles{0};
+    uint64_t split_iterations = 2'000'000;
+};
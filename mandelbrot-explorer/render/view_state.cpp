@@ -0,0 +1,108 @@
+#include "view_state.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "perturbation.h"
+
+namespace {
+
+// The center gets the limbs a window this wide needs to resolve its pixels
+constexpr int widest_window = 1 << 16;
+
+// Beyond this many view coordinates, the rounding of the pending offset starts to show in the pixels
+constexpr double fold_distance = 1024.0;
+
+// Zooming out stops here, where the whole set is far smaller than a pixel, and panning stops at max_center. Points of
+// the view then stay well below the 2^31 a BigFixed holds.
+constexpr double min_zoom = 1e-5;
+constexpr double max_center = 1 << 20;
+
+// center + offset / zoom, kept within max_center
+void move_center(BigFixed& center, double offset, const FloatExp& zoom, int fraction_limbs) {
+    // Any shift further than this crosses the whole range, limiting it keeps it in range of a BigFixed too
+    FloatExp limit = 2.0 * max_center;
+    FloatExp shift = std::max(-limit, std::min(FloatExp(offset) / zoom, limit));
+    center += BigFixed(shift, fraction_limbs);
+    if (std::fabs(center.to_double()) > max_center) {
+        center = BigFixed(center.is_negative() ? -max_center : max_center, fraction_limbs);
+    }
+}
+
+}  // namespace
+
+void ViewState::reset() {
+    zoom_value = 0.5;
+    exact_x = BigFixed();
+    exact_y = BigFixed();
+    folded_x = 0.0;
+    folded_y = 0.0;
+    offset_x = 0.0;
+    offset_y = 0.0;
+}
+
+void ViewState::pan(double coord_x, double coord_y) {
+    offset_x += coord_x;
+    offset_y += coord_y;
+    if (needs_fold()) {
+        fold();
+    }
+}
+
+void ViewState::zoom_at(double factor, double coord_x, double coord_y) {
+    // The fixed point p = center + coord / zoom = center' + coord / (zoom * factor), in the new view coordinates
+    // the offset from the center becomes offset * factor + coord * (factor - 1)
+    if (zoom_value * factor < FloatExp(min_zoom)) {
+        factor = (FloatExp(min_zoom) / zoom_value).to_double();
+    }
+    zoom_value = zoom_value * factor;
+    offset_x = offset_x * factor + coord_x * (factor - 1.0);
+    offset_y = offset_y * factor + coord_y * (factor - 1.0);
+    if (needs_fold()) {
+        fold();
+    }
+}
+
+const BigFixed& ViewState::center_x() {
+    fold();
+    return exact_x;
+}
+
+const BigFixed& ViewState::center_y() {
+    fold();
+    return exact_y;
+}
+
+std::string ViewState::describe_point(double coord_x, double coord_y) {
+    fold();
+    int fraction_limbs = exact_x.fraction_limbs();
+    BigFixed x = exact_x + BigFixed(FloatExp(coord_x) / zoom_value, fraction_limbs);
+    BigFixed y = exact_y + BigFixed(FloatExp(coord_y) / zoom_value, fraction_limbs);
+
+    // A pixel is 2 / (zoom * width), three more digits than that keep the point inside it
+    double pixel_digits = (zoom_value * (widest_window / 2.0)).log2() * std::log10(2.0);
+    int digits = std::max(static_cast<int>(std::ceil(pixel_digits)) + 3, 6);
+    return x.to_string(digits) + " " + y.to_string(digits);
+}
+
+bool ViewState::needs_fold() const {
+    // Past max_center the fold clamps the center, so pan_x() and pan_y() never go beyond it either
+    return std::fabs(offset_x) > fold_distance || std::fabs(offset_y) > fold_distance ||
+           std::fabs(pan_x()) > max_center || std::fabs(pan_y()) > max_center;
+}
+
+void ViewState::fold() {
+    int fraction_limbs = std::max(reference_fraction_limbs(zoom_value, widest_window), exact_x.fraction_limbs());
+    if (offset_x == 0.0 && offset_y == 0.0 && fraction_limbs == exact_x.fraction_limbs()) {
+        return;
+    }
+
+    exact_x.set_fraction_limbs(fraction_limbs);
+    exact_y.set_fraction_limbs(fraction_limbs);
+    move_center(exact_x, offset_x, zoom_value, fraction_limbs);
+    move_center(exact_y, offset_y, zoom_value, fraction_limbs);
+    folded_x = exact_x.to_double();
+    folded_y = exact_y.to_double();
+    offset_x = 0.0;
+    offset_y = 0.0;
+}
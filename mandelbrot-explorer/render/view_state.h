@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+
+#include "big_fixed.h"
+#include "float_exp.h"
+
+// Position and scale of the explorer's view at any depth. The center is kept in full precision and the zoom as a
+// FloatExp. Pans and zooms only move a double offset from the center, measured in view coordinates (the view spans
+// [-1, 1] horizontally), so they cost the same at every depth. The offset is folded into the center when the exact
+// center is asked for, at most once per frame, or when it has grown large enough to lose sub-pixel precision.
+class ViewState {
+   public:
+    ViewState() { reset(); }
+
+    // Whole set in view, zoom 0.5 around 0
+    void reset();
+
+    const FloatExp& zoom() const { return zoom_value; }
+
+    // Moves the view by (coord_x, coord_y) view coordinates
+    void pan(double coord_x, double coord_y);
+
+    // Multiplies the zoom by factor, keeping the point at (coord_x, coord_y) view coordinates in place
+    void zoom_at(double factor, double coord_x, double coord_y);
+
+    // Full-precision center, with enough fractional limbs for windows up to 65536 pixels wide
+    const BigFixed& center_x();
+    const BigFixed& center_y();
+
+    // Center rounded to double, for the shaders that take the view as zoom and pan
+    double pan_x() const { return folded_x + (FloatExp(offset_x) / zoom_value).to_double(); }
+    double pan_y() const { return folded_y + (FloatExp(offset_y) / zoom_value).to_double(); }
+
+    // Full-precision position of the point at (coord_x, coord_y) view coordinates, printed with enough digits to
+    // tell the pixels of the view apart
+    std::string describe_point(double coord_x, double coord_y);
+
+   private:
+    // Whether the pending offset has grown far enough to fold it now
+    bool needs_fold() const;
+
+    // Adds the pending offset to the full-precision center, which stays within a million of the origin
+    void fold();
+
+    BigFixed exact_x;
+    BigFixed exact_y;
+    // exact_x and exact_y rounded to double
+    double folded_x;
+    double folded_y;
+    // Not yet folded into the center, in view coordinates of the current zoom
+    double offset_x;
+    double offset_y;
+    FloatExp zoom_value;
+};
@@ -0,0 +1,20 @@
+#include "resolution_scaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+ResolutionScaler::ResolutionScaler(double target_fps) : target_seconds(target_fps > 0.0 ? 1.0 / target_fps : 0.0) {}
+
+void ResolutionScaler::add_frame_time(double seconds, float scale) {
+    if (target_seconds <= 0.0) return;
+    // Some drivers answer the first timer query of a context with garbage
+    if (seconds <= 0.0 || seconds > 10.0) return;
+
+    double full_frame = seconds / (static_cast<double>(scale) * scale);
+    // Averaged over a few frames, a single slow frame, a context switch for example, barely moves it
+    full_frame_seconds = full_frame_seconds > 0.0 ? 0.7 * full_frame_seconds + 0.3 * full_frame : full_frame;
+
+    double wanted = std::sqrt(target_seconds / full_frame_seconds);
+    float stepped = std::floor(static_cast<float>(wanted) / scale_step) * scale_step;
+    current_scale = std::clamp(stepped, min_scale, 1.0f);
+}
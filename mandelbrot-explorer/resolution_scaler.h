@@ -0,0 +1,26 @@
+#pragma once
+
+// Picks the fraction of the window's width and height the shaders render at while the view is changing, so that a
+// frame takes about as long as the target frame rate allows. The cost of a frame grows with its pixel count, the
+// square of the scale, so every measured frame gives an estimate of what a full resolution frame costs.
+class ResolutionScaler {
+   public:
+    static constexpr float min_scale = 0.25f;
+
+    // target_fps <= 0 always renders at full resolution
+    explicit ResolutionScaler(double target_fps);
+
+    float scale() const { return current_scale; }
+
+    // GPU time of a frame drawn at scale
+    void add_frame_time(double seconds, float scale);
+
+   private:
+    // Steps the scale moves in, so that small changes in frame time do not resize the frame every time
+    static constexpr float scale_step = 0.05f;
+
+    double target_seconds;
+    // Moving average of what a full resolution frame costs, 0 before the first frame
+    double full_frame_seconds = 0.0;
+    float current_scale = 1.0f;
+};
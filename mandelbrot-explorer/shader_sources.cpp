@@ -0,0 +1,40 @@
+#include "shader_sources.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+struct EmbeddedShader {
+    const char* name;
+    const char* source;
+};
+
+// Generated from shaders/*.glsl into the intermediate directory, defines embedded_shaders[]
+#include "embedded_shaders.h"
+
+std::string read_shader_file(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return "";
+    }
+
+    std::ostringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+}  // namespace
+
+std::string shader_source(const std::string& name, const std::string& directory) {
+    if (!directory.empty()) {
+        return read_shader_file(directory + "/" + name);
+    }
+    for (const EmbeddedShader& shader : embedded_shaders) {
+        if (name == shader.name) return shader.source;
+    }
+    std::cerr << "No embedded shader named " << name << std::endl;
+    return "";
+}
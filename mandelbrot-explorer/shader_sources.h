@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+
+// Source of the shader file with the given name, for example "vertexShader.glsl". The files in shaders/ are compiled
+// into the executable by the EmbedShaders target of the project, so it runs from any working directory. With a
+// directory the file is read from there instead, to try shader edits without a rebuild. Returns an empty string after
+// printing an error when there is no such shader.
+std::string shader_source(const std::string& name, const std::string& directory);
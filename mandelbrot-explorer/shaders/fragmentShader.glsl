@@ -2,10 +2,18 @@
 in vec2 coord;
 out vec4 FragColor;
 
-uniform float zoom;
-uniform vec2 pan;
-uniform float aspectRatio; 
-uniform int max_iterations;
+// The view, uploaded once per frame into a buffer every shader shares (ViewUniforms in main.cpp)
+layout(std140, binding = 0) uniform View {
+    vec2 pan;
+    vec2 pan_hi;
+    vec2 pan_lo;
+    vec2 reference_offset;
+    float zoom;
+    float inverse_zoom;
+    float aspectRatio;
+    int max_iterations;
+    int orbit_length;
+};
 
 // All components are in the range [0…1]
 vec3 hsv2rgb(vec3 c) {
@@ -4,10 +4,20 @@
 in vec2 coord;
 out vec4 FragColor;
 
-uniform double zoom_double;
-uniform dvec2 pan_double;
-uniform float aspectRatio; 
-uniform int max_iterations;
+// The view, the same block as in the float shaders followed by the doubles, so those never declare fp64 types
+layout(std140, binding = 0) uniform View {
+    vec2 pan;
+    vec2 pan_hi;
+    vec2 pan_lo;
+    vec2 reference_offset;
+    float zoom;
+    float inverse_zoom;
+    float aspectRatio;
+    int max_iterations;
+    int orbit_length;
+    dvec2 pan_double;
+    double zoom_double;
+};
 
 // All components are in the range [0…1]
 vec3 hsv2rgb(vec3 c) {
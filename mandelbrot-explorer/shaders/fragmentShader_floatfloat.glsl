@@ -0,0 +1,111 @@
+#version 450
+
+in vec2 coord;
+out vec4 FragColor;
+
+// The view, shared with the other shaders. This one reads the view center as an unevaluated sum pan_hi + pan_lo of
+// two floats, about 48 bits, without any fp64. The offset of a pixel from it is small enough for a single float.
+layout(std140, binding = 0) uniform View {
+    vec2 pan;
+    vec2 pan_hi;
+    vec2 pan_lo;
+    vec2 reference_offset;
+    float zoom;
+    float inverse_zoom;
+    float aspectRatio;
+    int max_iterations;
+    int orbit_length;
+};
+
+// All components are in the range [0…1]
+vec3 hsv2rgb(vec3 c) {
+    vec4 K = vec4(1.0, 2.0 / 3.0, 1.0 / 3.0, 3.0);
+    vec3 p = abs(fract(c.xxx + K.xyz) * 6.0 - K.www);
+    return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);
+}
+
+// Float-float numbers hold the value in x and the rounding error of x in y. The error terms only survive if the
+// compiler neither fuses nor reorders the operations, which is what precise guarantees.
+
+// Knuth's two-sum, a + b
+vec2 ff_add(vec2 a, vec2 b) {
+    precise float s = a.x + b.x;
+    precise float v = s - a.x;
+    precise float e = (a.x - (s - v)) + (b.x - v) + (a.y + b.y);
+    precise float hi = s + e;
+    precise float lo = e - (hi - s);
+    return vec2(hi, lo);
+}
+
+vec2 ff_sub(vec2 a, vec2 b) {
+    return ff_add(a, -b);
+}
+
+// Dekker's product: splitting both factors into halves of 12 bits makes every partial product exact, so the
+// rounding error of a.x * b.x is recovered without fma, whose precision GLSL leaves to the implementation
+vec2 ff_split(float a) {
+    precise float t = 4097.0 * a;
+    precise float hi = t - (t - a);
+    precise float lo = a - hi;
+    return vec2(hi, lo);
+}
+
+float ff_product_error(float a, float b, float p) {
+    vec2 as = ff_split(a);
+    vec2 bs = ff_split(b);
+    precise float e = ((as.x * bs.x - p) + as.x * bs.y + as.y * bs.x) + as.y * bs.y;
+    return e;
+}
+
+vec2 ff_mul(vec2 a, vec2 b) {
+    precise float p = a.x * b.x;
+    precise float e = ff_product_error(a.x, b.x, p) + (a.x * b.y + a.y * b.x);
+    precise float hi = p + e;
+    precise float lo = e - (hi - p);
+    return vec2(hi, lo);
+}
+
+vec2 ff_sqr(vec2 a) {
+    precise float p = a.x * a.x;
+    precise float e = ff_product_error(a.x, a.x, p) + 2.0 * a.x * a.y;
+    precise float hi = p + e;
+    precise float lo = e - (hi - p);
+    return vec2(hi, lo);
+}
+
+
+void main()
+{
+    vec2 offset = vec2(coord.x, coord.y * (1.0 / aspectRatio)) * inverse_zoom;
+    vec2 cx = ff_add(vec2(pan_hi.x, pan_lo.x), vec2(offset.x, 0.0));
+    vec2 cy = ff_add(vec2(pan_hi.y, pan_lo.y), vec2(offset.y, 0.0));
+    vec2 zx = cx;
+    vec2 zy = cy;
+
+    int i;
+
+    for (i = 0; i < max_iterations; i++)
+    {
+        vec2 xtemp = ff_add(ff_sub(ff_sqr(zx), ff_sqr(zy)), cx);
+        // Doubling is exact
+        zy = ff_add(2.0 * ff_mul(zx, zy), cy);
+        zx = xtemp;
+
+        if (zx.x * zx.x + zy.x * zy.x > 4.0)
+            break;
+    }
+
+
+    if (i == max_iterations){
+        float white_shade = 0.9;
+        FragColor = vec4(white_shade, white_shade, white_shade, white_shade);
+    } else {
+        float col = float(i) / float(max_iterations);
+        int cuttoff = min(max_iterations/2, 50);
+        if (i < cuttoff){
+            FragColor = vec4(hsv2rgb(vec3(col, 1.0, float(i) / cuttoff)), 1.0);
+        } else {
+            FragColor = vec4(hsv2rgb(vec3(col, 1.0, 1.0)), 1.0);
+        }
+    }
+}
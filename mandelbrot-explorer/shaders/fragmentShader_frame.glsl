@@ -0,0 +1,12 @@
+#version 450
+
+in vec2 coord;
+out vec4 FragColor;
+
+// Frame rendered on the CPU, its first row is the top of the window
+uniform sampler2D frame;
+
+void main()
+{
+    FragColor = texture(frame, vec2(coord.x * 0.5 + 0.5, 0.5 - coord.y * 0.5));
+}
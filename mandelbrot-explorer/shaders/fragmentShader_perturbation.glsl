@@ -0,0 +1,74 @@
+#version 450
+
+in vec2 coord;
+out vec4 FragColor;
+
+// Reference orbit Z_0 = 0, Z_1 = C, ... computed on the CPU in full precision, one point per texel
+uniform samplerBuffer orbit;
+// The view, shared with the other shaders. reference_offset is (view center - C) * zoom, so the offset of a pixel
+// from C is (coord + reference_offset) * inverse_zoom.
+layout(std140, binding = 0) uniform View {
+    vec2 pan;
+    vec2 pan_hi;
+    vec2 pan_lo;
+    vec2 reference_offset;
+    float zoom;
+    float inverse_zoom;
+    float aspectRatio;
+    int max_iterations;
+    int orbit_length;
+};
+
+// All components are in the range [0…1]
+vec3 hsv2rgb(vec3 c) {
+    vec4 K = vec4(1.0, 2.0 / 3.0, 1.0 / 3.0, 3.0);
+    vec3 p = abs(fract(c.xxx + K.xyz) * 6.0 - K.www);
+    return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);
+}
+
+
+void main()
+{
+    vec2 dc = (vec2(coord.x, coord.y * (1.0 / aspectRatio)) + reference_offset) * inverse_zoom;
+
+    // Every pixel iterates only its offset dz = z - Z, with dz' = (2Z + dz) * dz + dc.
+    // It starts from z = c like the other shaders, which is Z_1 + dc.
+    vec2 dz = dc;
+    int n = 1;
+
+    int i;
+
+    for (i = 0; i < max_iterations; i++)
+    {
+        vec2 Z = texelFetch(orbit, n).xy;
+        vec2 t = 2.0 * Z + dz;
+        dz = vec2(t.x * dz.x - t.y * dz.y, t.x * dz.y + t.y * dz.x) + dc;
+        n++;
+
+        vec2 z = texelFetch(orbit, n).xy + dz;
+        float z_squared = dot(z, z);
+        if (z_squared > 4.0)
+            break;
+
+        // Rebase onto the start of the orbit when the pixel comes closer to 0 than to the reference, where the
+        // offset would lose its precision, or when the reference escaped before the pixel
+        if (z_squared < dot(dz, dz) || n == orbit_length - 1) {
+            dz = z;
+            n = 0;
+        }
+    }
+
+
+    if (i == max_iterations){
+        float white_shade = 0.9;
+        FragColor = vec4(white_shade, white_shade, white_shade, white_shade);
+    } else {
+        float col = float(i) / float(max_iterations);
+        int cuttoff = min(max_iterations/2, 50);
+        if (i < cuttoff){
+            FragColor = vec4(hsv2rgb(vec3(col, 1.0, float(i) / cuttoff)), 1.0);
+        } else {
+            FragColor = vec4(hsv2rgb(vec3(col, 1.0, 1.0)), 1.0);
+        }
+    }
+}
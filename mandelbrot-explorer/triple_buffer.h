@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+
+// Hands the newest value from one writer thread to one reader thread without either of them ever waiting. The writer
+// fills a slot of its own and swaps it into the middle, the reader swaps the middle out when it holds something newer
+// than its own slot, so each side only touches a slot the other cannot reach. Values published faster than the reader
+// takes them are overwritten, the reader always gets the newest. Unlike a seqlock it works for values that own memory.
+template <typename T>
+class TripleBuffer {
+   public:
+    // Slot the writer fills before publish(). It holds an older value, so every member has to be written again.
+    T& write_slot() { return slots[write_index]; }
+
+    void publish() {
+        int previous = middle.exchange(write_index | fresh_flag, std::memory_order_acq_rel);
+        write_index = previous & index_mask;
+    }
+
+    // Takes the newest published value if there is one the reader has not seen, returns whether there was
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & fresh_flag)) return false;
+        int previous = middle.exchange(read_index, std::memory_order_acq_rel);
+        read_index = previous & index_mask;
+        return true;
+    }
+
+    // The value update() took last, only for the reader
+    T& read_slot() { return slots[read_index]; }
+
+   private:
+    static constexpr int index_mask = 3;
+    static constexpr int fresh_flag = 4;
+
+    T slots[3];
+    int write_index = 0;
+    // Index of the slot in between, with fresh_flag while the reader has not taken it
+    std::atomic<int> middle{1};
+    int read_index = 2;
+};
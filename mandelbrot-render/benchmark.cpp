@@ -0,0 +1,342 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include "render/cpu_renderer.h"
+
+namespace {
+
+// The two kinds of view the README benchmark describes, at 1080p and 1000 iterations
+struct BenchmarkView {
+    const char* name;
+    double zoom;
+    double pan_x;
+    double pan_y;
+};
+
+const BenchmarkView benchmark_views[] = {
+    {"average area", 0.5, 0.0, 0.0},
+    {"all max-iterations", 20.0, -0.2, 0.0},
+};
+
+// Filaments next to the set boundary, where neighbouring pixels need very different iteration counts
+const BenchmarkView boundary_view = {"boundary-heavy", 100000.0, -0.743643887, 0.131825904};
+
+// Perturbation views at increasing depth. The seahorse valley has few iterations in common between the pixels, the
+// Misiurewicz point c = i has structure at any depth and pixels that share all but the last few hundred iterations.
+struct DeepView {
+    const char* name;
+    const char* center_x;
+    const char* center_y;
+    // Parsed as FloatExp, so it may lie past 1e308
+    const char* zoom;
+    int max_iterations;
+};
+
+const DeepView deep_views[] = {
+    {"seahorse valley", "-0.743643887037158704752191506114774", "0.131825904205311970493132056385139", "1e11", 4000},
+    {"c = i", "0", "1", "1e50", 20000},
+    {"c = i", "0", "1", "1e100", 20000},
+    {"c = i", "0", "1", "1e200", 20000},
+    {"c = i", "0", "1", "1e300", 20000},
+    {"c = i", "0", "1", "1e1000", 20000},
+    // The reference stays close to |Z| = 2, so pixels escape in the middle of steps that would skip past them
+    {"near -2", "-1.99999999999999999999999999999", "0.000000000000000000000000000001", "1e20", 3000},
+};
+
+// Depths within reach of double-double (about 32 digits) and quad-double (about 64 digits). c = i would not need
+// either, 1 + offset is exact in two doubles, so the views are centered on a Misiurewicz point whose binary digits do
+// not run out, which also has structure at any depth.
+const char* const misiurewicz_x =
+    "-0.101096363845622161025785445738622565463805442826253483876931177660780840740470584274821220";
+const char* const misiurewicz_y =
+    "0.956286510809141500771096057729977435809833336510529170034314321500524659065716732526978411";
+
+struct MultiDoubleView {
+    const char* zoom;
+    ExtendedPrecision precision;
+};
+
+const MultiDoubleView multi_double_views[] = {
+    {"1e20", ExtendedPrecision::DoubleDouble}, {"1e25", ExtendedPrecision::DoubleDouble},
+    {"1e35", ExtendedPrecision::QuadDouble},   {"1e45", ExtendedPrecision::QuadDouble},
+    {"1e55", ExtendedPrecision::QuadDouble},
+};
+
+RenderParams benchmark_params(const BenchmarkView& view, bool use_double_precision) {
+    RenderParams params;
+    params.width = 1920;
+    params.height = 1080;
+    params.aspectRatio = static_cast<float>(params.width) / static_cast<float>(params.height);
+    params.max_iterations = 1000;
+    params.zoom = view.zoom;
+    params.pan_x = view.pan_x;
+    params.pan_y = view.pan_y;
+    params.use_double_precision = use_double_precision;
+    return params;
+}
+
+// Best of a few runs, the first one also warms up the thread pool
+double time_render(CpuRenderer& renderer, const RenderParams& params, std::vector<uint32_t>& iterations) {
+    double best = 1e30;
+    for (int run = 0; run < 3; run++) {
+        auto start = std::chrono::steady_clock::now();
+        renderer.render_iterations(params, iterations);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, seconds);
+    }
+    return best;
+}
+
+void benchmark_kernels(unsigned threads) {
+    CpuRenderer renderer(threads);
+    SimdLevel detected = detect_simd_level();
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512};
+
+    printf("Escape-time kernels, 1920x1080, 1000 iterations, %u threads, detected %s\n", renderer.thread_count(),
+           simd_level_name(detected));
+    printf("%-20s %-8s %-7s %6s %12s %9s\n", "view", "type", "kernel", "lanes", "Mpixel/s", "speedup");
+
+    for (const BenchmarkView& view : benchmark_views) {
+        double scalar_seconds = 0.0;
+        for (bool use_double : {false, true}) {
+            RenderParams params = benchmark_params(view, use_double);
+            std::vector<uint32_t> reference;
+
+            for (SimdLevel level : levels) {
+                if (level > detected) continue;
+                renderer.set_simd_level(level);
+                if (renderer.simd_level() != level) continue;
+
+                std::vector<uint32_t> iterations;
+                double seconds = time_render(renderer, params, iterations);
+                if (level == SimdLevel::Scalar) {
+                    reference = iterations;
+                    scalar_seconds = seconds;
+                }
+
+                const EscapeKernels& kernels = get_escape_kernels(level);
+                double pixels = static_cast<double>(params.width) * params.height;
+                printf("%-20s %-8s %-7s %6d %12.2f %8.2fx%s\n", view.name, use_double ? "double" : "float",
+                       simd_level_name(level), use_double ? kernels.double_lanes : kernels.float_lanes,
+                       pixels / seconds / 1e6, scalar_seconds / seconds,
+                       iterations == reference ? "" : "  MISMATCH vs scalar");
+            }
+        }
+
+        // Fixed point has only the scalar kernel, its speedup is against scalar double
+        RenderParams params = benchmark_params(view, false);
+        params.extended_precision = ExtendedPrecision::Fixed128;
+        params.center_x = BigFixed(view.pan_x, 4);
+        params.center_y = BigFixed(view.pan_y, 4);
+        std::vector<uint32_t> iterations;
+        double seconds = time_render(renderer, params, iterations);
+        double pixels = static_cast<double>(params.width) * params.height;
+        printf("%-20s %-8s %-7s %6d %12.2f %8.2fx\n", view.name, "fixed128", simd_level_name(SimdLevel::Scalar), 1,
+               pixels / seconds / 1e6, scalar_seconds / seconds);
+    }
+}
+
+void benchmark_refill(unsigned threads) {
+    CpuRenderer renderer(threads);
+    SimdLevel detected = detect_simd_level();
+    const SimdLevel levels[] = {SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512};
+
+    printf("Lane refill, 1920x1080, 1000 iterations, %u threads\n", renderer.thread_count());
+    printf("%-20s %-7s %-7s %12s %12s %9s\n", "view", "type", "kernel", "plain Mpx/s", "refill Mpx/s", "speedup");
+
+    std::vector<BenchmarkView> views(std::begin(benchmark_views), std::end(benchmark_views));
+    views.push_back(boundary_view);
+
+    for (const BenchmarkView& view : views) {
+        for (bool use_double : {false, true}) {
+            RenderParams params = benchmark_params(view, use_double);
+            double pixels = static_cast<double>(params.width) * params.height;
+
+            for (SimdLevel level : levels) {
+                if (level > detected) continue;
+                renderer.set_simd_level(level);
+
+                std::vector<uint32_t> plain_iterations;
+                renderer.set_lane_refill(false);
+                double plain_seconds = time_render(renderer, params, plain_iterations);
+
+                std::vector<uint32_t> refill_iterations;
+                renderer.set_lane_refill(true);
+                double refill_seconds = time_render(renderer, params, refill_iterations);
+
+                printf("%-20s %-7s %-7s %12.2f %12.2f %8.2fx%s\n", view.name, use_double ? "double" : "float",
+                       simd_level_name(level), pixels / plain_seconds / 1e6, pixels / refill_seconds / 1e6,
+                       plain_seconds / refill_seconds,
+                       plain_iterations == refill_iterations ? "" : "  MISMATCH vs plain");
+            }
+        }
+    }
+}
+
+void benchmark_bla(unsigned threads) {
+    CpuRenderer renderer(threads);
+
+    printf("Bilinear approximation, 800x450, %u threads\n", renderer.thread_count());
+    printf("%-16s %7s %11s %11s %11s %9s %9s\n", "view", "zoom", "iterations", "plain s", "BLA s", "skipped",
+           "speedup");
+
+    for (const DeepView& view : deep_views) {
+        RenderParams params;
+        params.width = 800;
+        params.height = 450;
+        params.aspectRatio = static_cast<float>(params.width) / static_cast<float>(params.height);
+        params.max_iterations = view.max_iterations;
+        FloatExp::parse(view.zoom, params.zoom);
+        params.use_perturbation = true;
+        int fraction_limbs = reference_fraction_limbs(params.zoom, params.width);
+        BigFixed::parse(view.center_x, fraction_limbs, params.center_x);
+        BigFixed::parse(view.center_y, fraction_limbs, params.center_y);
+
+        // The reference orbit is computed on the first run only, time_render keeps the best run
+        std::vector<uint32_t> plain_iterations;
+        renderer.set_bilinear_approximation(false);
+        double plain_seconds = time_render(renderer, params, plain_iterations);
+
+        std::vector<uint32_t> bla_iterations;
+        renderer.set_bilinear_approximation(true);
+        double bla_seconds = time_render(renderer, params, bla_iterations);
+        const PerturbationStats& stats = renderer.perturbation_stats();
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < plain_iterations.size(); i++) {
+            mismatches += plain_iterations[i] != bla_iterations[i];
+        }
+        printf("%-16s %7s %11llu %11.3f %11.3f %8.1f%% %8.2fx", view.name, view.zoom,
+               static_cast<unsigned long long>(stats.iterations), plain_seconds, bla_seconds,
+               100.0 * stats.skipped_iterations / stats.iterations, plain_seconds / bla_seconds);
+        if (mismatches > 0) {
+            printf("  %zu pixels differ", mismatches);
+        }
+        printf("\n");
+    }
+}
+
+// Perturbation only pays for its reference orbit and glitch passes once per frame, so it is timed with a new
+// renderer every run, as the first frame at a new location would be
+double time_perturbation(unsigned threads, const RenderParams& params, std::vector<uint32_t>& iterations) {
+    double best = 1e30;
+    for (int run = 0; run < 3; run++) {
+        CpuRenderer renderer(threads);
+        auto start = std::chrono::steady_clock::now();
+        renderer.render_iterations(params, iterations);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, seconds);
+    }
+    return best;
+}
+
+void benchmark_multi_double(unsigned threads) {
+    CpuRenderer renderer(threads);
+
+    printf("Double-double and quad-double versus perturbation at c = -0.1011 + 0.9563i, 2000 iterations, "
+           "%u threads (%s)\n",
+           renderer.thread_count(), simd_level_name(renderer.simd_level()));
+    printf("%-8s %6s %14s %13s %15s\n", "size", "zoom", "precision", "multi s", "perturbation s");
+
+    for (int width : {160, 800}) {
+        for (const MultiDoubleView& view : multi_double_views) {
+            RenderParams params;
+            params.width = width;
+            params.height = width * 9 / 16;
+            params.aspectRatio = static_cast<float>(params.width) / static_cast<float>(params.height);
+            params.max_iterations = 2000;
+            FloatExp::parse(view.zoom, params.zoom);
+            int fraction_limbs = std::max(reference_fraction_limbs(params.zoom, params.width), 7);
+            BigFixed::parse(misiurewicz_x, fraction_limbs, params.center_x);
+            BigFixed::parse(misiurewicz_y, fraction_limbs, params.center_y);
+
+            params.extended_precision = view.precision;
+            std::vector<uint32_t> multi_iterations;
+            double multi_seconds = time_render(renderer, params, multi_iterations);
+
+            params.extended_precision = ExtendedPrecision::None;
+            params.use_perturbation = true;
+            std::vector<uint32_t> perturbation_iterations;
+            double perturbation_seconds = time_perturbation(threads, params, perturbation_iterations);
+
+            size_t mismatches = 0;
+            for (size_t i = 0; i < multi_iterations.size(); i++) {
+                mismatches += multi_iterations[i] != perturbation_iterations[i];
+            }
+            printf("%4dx%-3d %6s %14s %13.3f %15.3f", params.width, params.height, view.zoom,
+                   view.precision == ExtendedPrecision::DoubleDouble ? "double-double" : "quad-double", multi_seconds,
+                   perturbation_seconds);
+            if (mismatches > 0) {
+                printf("  %zu pixels differ", mismatches);
+            }
+            printf("\n");
+        }
+    }
+}
+
+// Iterations per second of the reference orbit at c = i, which never escapes, timed over about a second of work
+double orbit_iterations_per_second(const BigFixed& c_x, const BigFixed& c_y, unsigned threads) {
+    int iterations = 10;
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        compute_reference_orbit(c_x, c_y, iterations, threads);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (seconds > 0.5 || iterations >= 1'000'000) {
+            return iterations / seconds;
+        }
+        iterations *= 4;
+    }
+}
+
+void benchmark_orbit() {
+    printf("Reference orbit at c = i, iterations per second, %u hardware threads\n",
+           std::thread::hardware_concurrency());
+    printf("%8s %6s %12s %12s %12s %9s\n", "digits", "limbs", "schoolbook", "Karatsuba", "3 threads", "speedup");
+
+    for (int digits : {100, 300, 1000, 3000, 10000, 30000}) {
+        int fraction_limbs = static_cast<int>(std::ceil(digits * std::log2(10.0) / 32.0));
+        BigFixed c_x(0.0, fraction_limbs);
+        BigFixed c_y(1.0, fraction_limbs);
+
+        BigFixed::set_karatsuba_threshold(1 << 30);
+        double schoolbook = orbit_iterations_per_second(c_x, c_y, 1);
+        BigFixed::set_karatsuba_threshold(BigFixed::default_karatsuba_threshold);
+        double karatsuba = orbit_iterations_per_second(c_x, c_y, 1);
+        double threaded = orbit_iterations_per_second(c_x, c_y, 3);
+        printf("%8d %6d %12.0f %12.0f %12.0f %8.2fx\n", digits, fraction_limbs, schoolbook, karatsuba, threaded,
+               threaded / schoolbook);
+    }
+}
+
+}  // namespace
+
+bool run_benchmark(const std::string& name, unsigned threads) {
+    if (name == "kernels") {
+        benchmark_kernels(threads);
+        return true;
+    }
+    if (name == "refill") {
+        benchmark_refill(threads);
+        return true;
+    }
+    if (name == "bla") {
+        benchmark_bla(threads);
+        return true;
+    }
+    if (name == "orbit") {
+        benchmark_orbit();
+        return true;
+    }
+    if (name == "multi-double") {
+        benchmark_multi_double(threads);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+
+// Runs the named benchmark and prints its results, returns false for an unknown name.
+// Benchmarks: "kernels", "refill", "bla", "orbit", "multi-double"
+bool run_benchmark(const std::string& name, unsigned threads);
@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "render/cpu_renderer.h"
+
+void print_usage() {
+    std::cout << "Usage: mandelbrot-render [options]\n"
+                 "  --width N            image width in pixels (default 1200)\n"
+                 "  --height N           image height in pixels (default 800)\n"
+                 "  --zoom X             zoom, same meaning as in the explorer, past 1e308 with --center (default 0.5)\n"
+                 "  --pan X Y            view center (default 0 0)\n"
+                 "  --max-iterations N   iteration limit (default 300)\n"
+                 "  --perturbation       deep zoom: iterate offsets from a full-precision reference orbit\n"
+                 "  --center X Y         view center as decimals of any length, implies --perturbation\n"
+                 "  --no-bla             iterate every perturbation step instead of skipping with bilinear approximation\n"
+                 "  --orbit-cache DIR    keep reference orbits in DIR and reuse them in later runs\n"
+                 "  --orbit-cache-mb N   size limit of the orbit cache, least recently used orbits go first (default 1024)\n"
+                 "  --double             use double precision (fragmentShader_doubles.glsl)\n"
+                 "  --double-double      iterate every pixel in double-double (106 bits) instead of perturbation\n"
+                 "  --quad-double        iterate every pixel in quad-double (212 bits) instead of perturbation\n"
+                 "  --fixed128           iterate every pixel in 128-bit fixed point, the same image on every build\n"
+                 "  --threads N          worker threads, 0 = one per core (default 0)\n"
+                 "  --simd LEVEL         scalar, sse2, avx2 or avx512 (default: best the CPU supports)\n"
+                 "  --refill             give escaped SIMD lanes the next pending pixel instead of idling\n"
+                 "  --stats              print how many tiles each thread rendered, stole and split\n"
+                 "  --progressive        render at 1/8, 1/4, 1/2 and full resolution and print when each pass is done\n"
+                 "  --output FILE        write a binary PPM image (default mandelbrot.ppm)\n"
+                 "  --bench NAME         run a benchmark instead of rendering: kernels, refill, bla, orbit,\n"
+                 "                       multi-double\n";
+}
+
+void print_worker_stats(const std::vector<WorkerStats>& stats) {
+    printf("thread  tiles  stolen  splits     pixels  stolen px    iterations   busy s\n");
+    for (size_t i = 0; i < stats.size(); i++) {
+        const WorkerStats& s = stats[i];
+        printf("%6zu %6d %7d %7d %10lld %10lld %13llu %8.3f\n", i, s.tiles, s.stolen_tiles, s.splits, s.pixels,
+               s.stolen_pixels, static_cast<unsigned long long>(s.iterations), s.busy_seconds);
+    }
+}
+
+bool write_ppm(const std::string& path, int width, int height, const std::vector<uint8_t>& rgba) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+    for (size_t i = 0; i < rgb.size() / 3; i++) {
+        rgb[3 * i + 0] = rgba[4 * i + 0];
+        rgb[3 * i + 1] = rgba[4 * i + 1];
+        rgb[3 * i + 2] = rgba[4 * i + 2];
+    }
+    file.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+    return static_cast<bool>(file);
+}
+
+int main(int argc, char** argv) {
+    RenderParams params;
+    unsigned threads = 0;
+    SimdLevel simd_level = detect_simd_level();
+    bool lane_refill = false;
+    bool print_stats = false;
+    bool progressive = false;
+    bool bilinear_approximation = true;
+    std::string orbit_cache_directory;
+    uint64_t orbit_cache_bytes = OrbitCache::default_max_bytes;
+    std::string center_x;
+    std::string center_y;
+    std::string benchmark;
+    std::string output = "mandelbrot.ppm";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        // number of values the option still needs after itself
+        auto need = [&](int count) {
+            if (i + count >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                std::exit(1);
+            }
+        };
+        if (arg == "--width") {
+            need(1);
+            params.width = std::atoi(argv[++i]);
+        } else if (arg == "--height") {
+            need(1);
+            params.height = std::atoi(argv[++i]);
+        } else if (arg == "--zoom") {
+            need(1);
+            if (!FloatExp::parse(argv[++i], params.zoom)) {
+                std::cerr << "Invalid zoom: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--pan") {
+            need(2);
+            params.pan_x = std::strtod(argv[++i], nullptr);
+            params.pan_y = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--max-iterations") {
+            need(1);
+            params.max_iterations = std::atoi(argv[++i]);
+        } else if (arg == "--double") {
+            params.use_double_precision = true;
+        } else if (arg == "--double-double") {
+            params.extended_precision = ExtendedPrecision::DoubleDouble;
+        } else if (arg == "--quad-double") {
+            params.extended_precision = ExtendedPrecision::QuadDouble;
+        } else if (arg == "--fixed128") {
+            params.extended_precision = ExtendedPrecision::Fixed128;
+        } else if (arg == "--perturbation") {
+            params.use_perturbation = true;
+        } else if (arg == "--center") {
+            need(2);
+            center_x = argv[++i];
+            center_y = argv[++i];
+            params.use_perturbation = true;
+        } else if (arg == "--no-bla") {
+            bilinear_approximation = false;
+        } else if (arg == "--orbit-cache") {
+            need(1);
+            orbit_cache_directory = argv[++i];
+        } else if (arg == "--orbit-cache-mb") {
+            need(1);
+            orbit_cache_bytes = std::strtoull(argv[++i], nullptr, 10) << 20;
+        } else if (arg == "--threads") {
+            need(1);
+            threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (arg == "--simd") {
+            need(1);
+            if (!parse_simd_level(argv[++i], simd_level)) {
+                std::cerr << "Unknown SIMD level: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--refill") {
+            lane_refill = true;
+        } else if (arg == "--stats") {
+            print_stats = true;
+        } else if (arg == "--progressive") {
+            progressive = true;
+        } else if (arg == "--bench") {
+            need(1);
+            benchmark = argv[++i];
+        } else if (arg == "--output") {
+            need(1);
+            output = argv[++i];
+        } else if (arg == "--help" || arg == "-h") {
+            print_usage();
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (!benchmark.empty()) {
+        if (!run_benchmark(benchmark, threads)) {
+            std::cerr << "Unknown benchmark: " << benchmark << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (params.width <= 0 || params.height <= 0 || params.max_iterations <= 0 || params.zoom <= 0.0) {
+        std::cerr << "Width, height, zoom and max iterations must be positive" << std::endl;
+        return 1;
+    }
+    params.aspectRatio = static_cast<float>(params.width) / static_cast<float>(params.height);
+
+    bool extended_precision = params.extended_precision != ExtendedPrecision::None;
+    if (extended_precision) {
+        params.use_perturbation = false;
+    }
+    if (params.use_perturbation || extended_precision) {
+        // Quad-double centers need 212 bits even when the zoom does not
+        int fraction_limbs = std::max(reference_fraction_limbs(params.zoom, params.width), extended_precision ? 7 : 0);
+        if (center_x.empty()) {
+            params.center_x = BigFixed(params.pan_x, fraction_limbs);
+            params.center_y = BigFixed(params.pan_y, fraction_limbs);
+        } else if (!BigFixed::parse(center_x, fraction_limbs, params.center_x) ||
+                   !BigFixed::parse(center_y, fraction_limbs, params.center_y)) {
+            std::cerr << "Invalid center: " << center_x << " " << center_y << std::endl;
+            return 1;
+        }
+    }
+
+    if (simd_level > detect_simd_level()) {
+        std::cerr << "This CPU does not support " << simd_level_name(simd_level) << std::endl;
+        return 1;
+    }
+
+    CpuRenderer renderer(threads);
+    renderer.set_simd_level(simd_level);
+    renderer.set_lane_refill(lane_refill);
+    renderer.set_bilinear_approximation(bilinear_approximation);
+    std::unique_ptr<OrbitCache> orbit_cache;
+    if (!orbit_cache_directory.empty()) {
+        orbit_cache = std::make_unique<OrbitCache>(orbit_cache_directory, orbit_cache_bytes);
+        renderer.set_orbit_cache(orbit_cache.get());
+    }
+    std::vector<uint8_t> rgba;
+
+    auto start = std::chrono::steady_clock::now();
+    if (progressive) {
+        renderer.render_progressive(params, [&](const std::vector<uint8_t>& pass_rgba, int spacing) {
+            double pass_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            printf("1/%d resolution after %.3f s\n", spacing, pass_seconds);
+            if (spacing == 1) {
+                rgba = pass_rgba;
+            }
+        });
+    } else {
+        renderer.render_frame(params, rgba);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("Rendered %dx%d on %u threads (%s) in %.3f s\n", params.width, params.height, renderer.thread_count(),
+           simd_level_name(renderer.simd_level()), seconds);
+    if (params.use_perturbation) {
+        const ReferenceOrbit& orbit = renderer.reference_orbit();
+        printf("Reference orbit: %zu iterations at %d bits%s\n", orbit.points.size() - 1,
+               32 * orbit.c_x.fraction_limbs(), orbit.escaped() ? ", escaped" : "");
+        if (orbit_cache) {
+            const OrbitCacheStats& cache = orbit_cache->stats();
+            printf("Orbit cache: %d loaded, %d extended, %d computed, %d evicted", cache.loaded, cache.extended,
+                   cache.computed, cache.evicted);
+            if (cache.failed_writes > 0) {
+                printf(", %d could not be written", cache.failed_writes);
+            }
+            printf("\n");
+        }
+        const PerturbationStats& stats = renderer.perturbation_stats();
+        printf("%d references, %d re-render passes, %lld glitched pixels", stats.references, stats.rerender_passes,
+               stats.glitched_pixels);
+        if (stats.unresolved_pixels > 0) {
+            printf(", %lld left unresolved", stats.unresolved_pixels);
+        }
+        printf("\n");
+        if (stats.iterations > 0) {
+            printf("%llu iterations, %.1f%% skipped by bilinear approximation\n",
+                   static_cast<unsigned long long>(stats.iterations), 100.0 * stats.skipped_iterations / stats.iterations);
+        }
+    }
+    if (print_stats) {
+        print_worker_stats(renderer.worker_stats());
+    }
+
+    if (!write_ppm(output, params.width, params.height, rgba)) {
+        return 1;
+    }
+    return 0;
+}